@@ -1,137 +1,89 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>  /* add if missing */
+#include <string.h>
 
-/* ============================
-<<<<<<< HEAD
-   LEXER INITIALIZATION
-   ============================ */
-=======
-   TOKEN DEFINITIONS
-   ============================ */
-typedef enum {
-    // End / Unknown
-    TOKEN_EOF,
-    TOKEN_UNKNOWN,
-
-    // Identifiers & words
-    TOKEN_IDENTIFIER,
-    TOKEN_KEYWORD,       // draft detection (you fill in isKeyword)
-    TOKEN_RESERVEDWORD,  // implemented below
-    TOKEN_NOISEWORD,     // implemented below
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
-
-    // Literals
-    TOKEN_INT_LITERAL,
-    TOKEN_FLOAT_LITERAL,
-    TOKEN_STRING_LITERAL,
-    TOKEN_CHAR_LITERAL,
-
-    // Comments
-    TOKEN_LINE_COMMENT,
-    TOKEN_BLOCK_COMMENT,
-
-    // Delimiters
-    TOKEN_LEFT_PARENTHESIS,
-    TOKEN_RIGHT_PARENTHESIS,
-    TOKEN_LEFT_BRACE,
-    TOKEN_RIGHT_BRACE,
-    TOKEN_LEFT_BRACKET,
-    TOKEN_RIGHT_BRACKET,
-    TOKEN_COMMA,
-    TOKEN_SEMICOLON,
-    TOKEN_COLON,
-    TOKEN_DOT,
-
-    // Quote delimiter tokens (explicit)
-    TOKEN_LEFT_STRING_QUOTATION,   // opening double-quote: "
-    TOKEN_RIGHT_STRING_QUOTATION,  // closing double-quote: "
-    TOKEN_LEFT_CHAR_QUOTATION,     // opening single-quote: '
-    TOKEN_RIGHT_CHAR_QUOTATION,    // closing single-quote: '
-
-    // Operators (explicit)
-    TOKEN_PLUS_OPERATOR,
-    TOKEN_MINUS_OPERATOR,
-    TOKEN_MULTIPLY_OPERATOR,
-    TOKEN_DIVIDE_OPERATOR,
-    TOKEN_MODULO_OPERATOR,
-    TOKEN_EXPONENT_OPERATOR,         // **
-    TOKEN_DIV_OPERATOR,              // $
-
-    TOKEN_ASSIGN_OPERATOR,           // =
-    TOKEN_EQUAL_OPERATOR,            // ==
-    TOKEN_LOGICAL_NOT_OPERATOR,      // !
-    TOKEN_NOT_EQUAL_OPERATOR,        // !=
-    TOKEN_LESS_THAN_OPERATOR,        // <
-    TOKEN_GREATER_THAN_OPERATOR,     // >
-    TOKEN_LESS_EQUAL_OPERATOR,       // <=
-    TOKEN_GREATER_EQUAL_OPERATOR,    // >=
-
-    TOKEN_INCREMENT_OPERATOR,        // ++
-    TOKEN_DECREMENT_OPERATOR,        // --
-    TOKEN_PLUS_ASSIGN_OPERATOR,      // +=
-    TOKEN_MINUS_ASSIGN_OPERATOR,     // -=
-    TOKEN_MULTIPLY_ASSIGN_OPERATOR,  // *=
-    TOKEN_DIVIDE_ASSIGN_OPERATOR,    // /=
-    TOKEN_MODULO_ASSIGN_OPERATOR,    // %=
-
-    TOKEN_LOGICAL_AND_OPERATOR,      // &&
-    TOKEN_LOGICAL_OR_OPERATOR        // ||
-} TokenType;
+#include "lexer.h"
 
 /* ============================
-   TOKEN STRUCT
-   ============================ */
-typedef struct {
-    TokenType type;
-    char *lexeme; // null-terminated string (malloc'd)
-} Token;
-
-/* ============================
-   LEXER STRUCT (with quote state)
+   LEXER INIT / UTIL
    ============================ */
-typedef struct {
-    const char *source;
-    int position;
-    char currentChar;
+static void *defaultAlloc(size_t size, void *ctx) {
+    (void)ctx;
+    return malloc(size);
+}
 
-    /* state for multi-step quote token emission */
-    int inStringContent;           // set after LEFT_STRING_QUOTATION, before returning STRING_LITERAL
-    int pendingRightStringQuote;   // set after STRING_LITERAL to emit RIGHT_STRING_QUOTATION next
+static void defaultRelease(void *ptr, void *ctx) {
+    (void)ctx;
+    free(ptr);
+}
 
-    int inCharContent;             // set after LEFT_CHAR_QUOTATION
-    int pendingRightCharQuote;     // set after CHAR_LITERAL to emit RIGHT_CHAR_QUOTATION next
-} Lexer;
+static void setAllocator(LexerAllocator *dst, const LexerAllocator *allocator) {
+    if (allocator) {
+        *dst = *allocator;
+    } else {
+        dst->alloc = defaultAlloc;
+        dst->release = defaultRelease;
+        dst->ctx = NULL;
+    }
+}
 
-/* ============================
-   LEXER INIT / UTIL
-   ============================ */
 void initLexer(Lexer *lexer, const char *source) {
+    initLexerWith(lexer, source, NULL);
+}
+
+void initLexerWith(Lexer *lexer, const char *source, const LexerAllocator *allocator) {
     lexer->source = source;
     lexer->position = 0;
     lexer->currentChar = source[0];
-    lexer->inStringContent = 0;
-    lexer->pendingRightStringQuote = 0;
-    lexer->inCharContent = 0;
-    lexer->pendingRightCharQuote = 0;
+    lexer->want = TOKEN_MASK_ALL;
+    lexer->copyLexemes = 1;
+    lexer->pendingHead = 0;
+    lexer->pendingCount = 0;
+    lexer->maxLexeme = 0;
+    lexer->recovery = LEXER_RECOVER_TO_EOF;
+    lexer->noCommentClose = -1;
+    lexer->brackets = NULL;
+    setAllocator(&lexer->allocator, allocator);
+}
+
+/* Restrict getNextToken to the types in want. Unwanted tokens are skipped
+   inside the lexer without allocation, and word classification is skipped
+   when no word type is wanted. copyLexemes = 0 drops the per-token copy
+   for wanted tokens too. */
+void setTokenFilter(Lexer *lexer, TokenMask want, int copyLexemes) {
+    lexer->want = want;
+    lexer->copyLexemes = copyLexemes;
 }
 
+/* Guards for untrusted input. Scanning is a single forward pass whatever the
+   input, so time is linear; maxLexeme also bounds the memory of any one
+   lexeme (longer tokens keep their full span and get TOKEN_FLAG_TRUNCATED).
+   recovery picks how far an unclosed comment or string reaches. */
+void setLexerLimits(Lexer *lexer, int maxLexeme, LexerRecovery recovery) {
+    lexer->maxLexeme = maxLexeme > 0 ? maxLexeme : 0;
+    lexer->recovery = recovery;
+}
+
+
 /* ============================
    LEXER UTILITY FUNCTIONS
    ============================ */
 
-void advance(Lexer *lexer) {
+static void advance(Lexer *lexer) {
     lexer->position++;
     lexer->currentChar = lexer->source[lexer->position];
 }
 
-char peek(Lexer *lexer) {
+static void seek(Lexer *lexer, int position) {
+    lexer->position = position;
+    lexer->currentChar = lexer->source[position];
+}
+
+static char peek(Lexer *lexer) {
     return lexer->source[lexer->position + 1];
 }
 
-void skipWhitespace(Lexer *lexer) {
-    /* don't skip inside content or pending closing quote */
-    if (lexer->inStringContent || lexer->inCharContent || lexer->pendingRightStringQuote || lexer->pendingRightCharQuote) return;
+static void skipWhitespace(Lexer *lexer) {
     while (lexer->currentChar == ' ' ||
            lexer->currentChar == '\t' ||
            lexer->currentChar == '\n' ||
@@ -140,60 +92,61 @@ void skipWhitespace(Lexer *lexer) {
     }
 }
 
-/* ============================
-<<<<<<< HEAD
-   HELPER FUNCTIONS
-   ============================ */
+/* copy len chars of text into a new string from the lexer's allocator */
+static char *copyText(Lexer *lexer, const char *text, int len) {
+    char *s = (char *)lexer->allocator.alloc((size_t)len + 1, lexer->allocator.ctx);
+    if (!s) return NULL;
+    memcpy(s, text, len);
+    s[len] = '\0';
+    return s;
+}
 
-int isAlpha(char c) {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c == '_');
-=======
+/* copy len source chars starting at start into token->lexeme, cut to
+   maxLexeme */
+static void copyLexeme(Lexer *lexer, Token *token, int start, int len) {
+    if (lexer->maxLexeme && len > lexer->maxLexeme) {
+        len = lexer->maxLexeme;
+        token->flags |= TOKEN_FLAG_TRUNCATED;
+    }
+    token->lexeme = copyText(lexer, lexer->source + start, len);
+}
+
+
+/* ============================
    CHARACTER CLASS HELPERS
    ============================ */
-int isAlpha(char c) {
+static int isAlpha(char c) {
     return (c >= 'a' && c <= 'z') ||
            (c >= 'A' && c <= 'Z') ||
            (c == '_');
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
 }
 
-int isDigit(char c) {
+static int isDigit(char c) {
     return (c >= '0' && c <= '9');
 }
 
-int isOperatorChar(char c) {
-    return c == '+' || c == '-' || c == '*' || c == '/' || c == '%' ||
-           c == '=' || c == '<' || c == '>' || c == '!' || c == '&' ||
-<<<<<<< HEAD
-           c == '|';
+static int isHexDigit(char c) {
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
 }
 
-int isDelimiter(char c) {
-    return c == '(' || c == ')' || c == '{' || c == '}' ||
-           c == '[' || c == ']' || c == ',' || c == ';' ||
-           c == '.' || c == ':' || c == '"' || c == '\'';
-}
-
-/* ============================
-   WORD CLASSIFICATION
-   ============================ */
-
-=======
+static int isOperatorChar(char c) {
+    return c == '+' || c == '-' || c == '*' || c == '/' || c == '%' ||
+           c == '=' || c == '<' || c == '>' || c == '!' || c == '&' ||
            c == '|' || c == '$';
 }
 
-int isDelimiterChar(char c) {
+static int isDelimiterChar(char c) {
     /* do not treat quotes here — handled separately */
     return c == '(' || c == ')' || c == '{' || c == '}' ||
            c == '[' || c == ']' || c == ',' || c == ';' ||
            c == '.' || c == ':';
 }
 
+
 /* ============================
    WORD CLASSIFICATION (LETTER-BY-LETTER)
    ============================ */
 /* ...existing isKeyword/isReservedWord/isNoiseWord implementations... */
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
 int isKeyword(const char *lexeme) {
     if (!lexeme || !lexeme[0]) return 0;
     switch (lexeme[0]) {
@@ -205,89 +158,14 @@ int isKeyword(const char *lexeme) {
             if (lexeme[1]=='i' && lexeme[2]=='g' && lexeme[3]=='i' && lexeme[4]=='t' && lexeme[5]=='\0') return 1;
             if (lexeme[1]=='u' && lexeme[2]=='r' && lexeme[3]=='i' && lexeme[4]=='n' && lexeme[5]=='g' && lexeme[6]=='\0') return 1;
             break;
-<<<<<<< HEAD
-        case 'i': /* indiv, instead */
-            if (lexeme[1]=='n' && lexeme[2]=='d' && lexeme[3]=='i' && lexeme[4]=='v' && lexeme[5]=='\0') return 1;
-            if (lexeme[1]=='n' && lexeme[2]=='s' && lexeme[3]=='t' && lexeme[4]=='e' && lexeme[5]=='a' && lexeme[6]=='d' && lexeme[7]=='\0') return 1;
-            break;
-        case 'l': /* large, long */
-            if (lexeme[1]=='a' && lexeme[2]=='r' && lexeme[3]=='g' && lexeme[4]=='e' && lexeme[5]=='\0') return 1;
-            if (lexeme[1]=='o' && lexeme[2]=='n' && lexeme[3]=='g' && lexeme[4]=='\0') return 1;
-            break;
-        case 'o': /* otherwise */
-            if (lexeme[1]=='t' && lexeme[2]=='h' && lexeme[3]=='e' && lexeme[4]=='r' && lexeme[5]=='w' && lexeme[6]=='i' && lexeme[7]=='s' && lexeme[8]=='e' && lexeme[9]=='\0') return 1;
-            break;
-        case 'p': /* perform */
-            if (lexeme[1]=='e' && lexeme[2]=='f' && lexeme[3]=='o' && lexeme[4]=='r' && lexeme[5]=='m' && lexeme[6]=='\0') return 1;
-            break;
-        case 's': /* select, short, skip, stop*/
-            if (lexeme[1]=='e' && lexeme[2]=='l' && lexeme[3]=='e' && lexeme[4]=='c' && lexeme[5]=='t' && lexeme[6]=='\0') return 1;
-            if (lexeme[1]=='h' && lexeme[2]=='o' && lexeme[3]=='r' && lexeme[4]=='t' && lexeme[5]=='\0') return 1;
-            if (lexeme[1]=='k' && lexeme[2]=='i' && lexeme[3]=='p' && lexeme[4]=='\0') return 1;
-            if (lexeme[1]=='t' && lexeme[2]=='o' && lexeme[3]=='p' && lexeme[4]=='\0') return 1;
-            break;
-        case 't': /* tiny, test */
-            if (lexeme[1]=='i' && lexeme[2]=='n' && lexeme[3]=='y' && lexeme[4]=='\0') return 1;
-            break;
-        case 'w': /* when */
-            if (lexeme[1]=='h' && lexeme[2]=='e' && lexeme[3]=='n' && lexeme[4]=='\0') return 1;
-            break;
-    }
-    return 0;
-}
-
-int isReservedWord(const char *lexeme) {
-    if (!lexeme || !lexeme[0]) return 0;
-    switch (lexeme[0]) {
-        case 'a': /* alias */
-            if (lexeme[1]=='l' && lexeme[2]=='i' && lexeme[3]=='a' && lexeme[4]=='s' && lexeme[5]=='\0') return 1;
-            break;
-        case 'b': /* blank, bothsign */
-            if (lexeme[1]=='l' && lexeme[2]=='a' && lexeme[3]=='n' && lexeme[4]=='k' && lexeme[5]=='\0') return 1;
-            if (lexeme[1]=='o' && lexeme[2]=='t' && lexeme[3]=='h' && lexeme[4]=='s' && lexeme[5]=='i' && lexeme[6]=='g' && lexeme[7]=='n' && lexeme[8]=='\0') return 1;
-            break;
-        case 'f': /* false, fixed */
-            if (lexeme[1]=='a' && lexeme[2]=='l' && lexeme[3]=='s' && lexeme[4]=='e' && lexeme[5]=='\0') return 1;
-            if (lexeme[1]=='i' && lexeme[2]=='x' && lexeme[3]=='e' && lexeme[4]=='d' && lexeme[5]=='\0') return 1;
-            break;
-        case 'g': /* group */
-            if (lexeme[1]=='r' && lexeme[2]=='o' && lexeme[3]=='u' && lexeme[4]=='p' && lexeme[5]=='\0') return 1;
-            break;
-        case 'j': /* jumpto */
-            if (lexeme[1]=='u' && lexeme[2]=='m' && lexeme[3]=='p' && lexeme[4]=='t' && lexeme[5]=='o' && lexeme[6]=='\0') return 1;
-            break;
-        case 'k': /* keep */
-            if (lexeme[1]=='e' && lexeme[2]=='e' && lexeme[3]=='p' && lexeme[4]=='\0') return 1;
-            break;
-        case 'l': /* link, live, local */
-            if (lexeme[1]=='i' && lexeme[2]=='n' && lexeme[3]=='k' && lexeme[4]=='\0') return 1;
-            if (lexeme[1]=='i' && lexeme[2]=='v' && lexeme[3]=='e' && lexeme[4]=='\0') return 1;
-            if (lexeme[1]=='o' && lexeme[2]=='c' && lexeme[3]=='a' && lexeme[4]=='l' && lexeme[5]=='\0') return 1;
-=======
         case 'i': // indiv, instead
             if (lexeme[1]=='n' && lexeme[2]=='d' && lexeme[3]=='i' && lexeme[4]=='v' && lexeme[5]=='\0') return 1;
             if (lexeme[1]=='n' && lexeme[2]=='s' && lexeme[3]=='t' && lexeme[4]=='e' && lexeme[5]=='a' && lexeme[6]=='d' && lexeme[7]=='\0') return 1;
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
             break;
         case 'l': // large, long
             if (lexeme[1]=='a' && lexeme[2]=='r' && lexeme[3]=='g' && lexeme[4]=='e' && lexeme[5]=='\0') return 1;
             if (lexeme[1]=='o' && lexeme[2]=='n' && lexeme[3]=='g' && lexeme[4]=='\0') return 1;
             break;
-<<<<<<< HEAD
-        case 'r': /* register */
-            if (lexeme[1]=='e' && lexeme[2]=='g' && lexeme[3]=='i' && lexeme[4]=='s' && lexeme[5]=='t' && lexeme[6]=='e' && lexeme[7]=='r' && lexeme[8]=='\0') return 1;
-            break;
-        case 's': /* set, shared, size */
-            if (lexeme[1]=='e' && lexeme[2]=='t' && lexeme[3]=='\0') return 1;
-            if (lexeme[1]=='h' && lexeme[2]=='a' && lexeme[3]=='r' && lexeme[4]=='e' && lexeme[5]=='d' && lexeme[6]=='\0') return 1;
-            if (lexeme[1]=='i' && lexeme[2]=='z' && lexeme[3]=='e' && lexeme[4]=='\0') return 1;
-            break;
-        case 't': /* true */
-            if (lexeme[1]=='r' && lexeme[2]=='u' && lexeme[3]=='e' && lexeme[4]=='\0') return 1;
-            break;
-        case 'w': /* whole */
-            if (lexeme[1]=='h' && lexeme[2]=='o' && lexeme[3]=='l' && lexeme[4]=='e' && lexeme[5]=='\0') return 1;
-=======
         case 'o': // otherwise
             if (lexeme[1]=='t' && lexeme[2]=='h' && lexeme[3]=='e' && lexeme[4]=='r' && lexeme[5]=='w' && lexeme[6]=='i' && lexeme[7]=='s' && lexeme[8]=='e' && lexeme[9]=='\0') return 1;
             break;
@@ -305,24 +183,11 @@ int isReservedWord(const char *lexeme) {
             break;
         case 'w': // when
             if (lexeme[1]=='h' && lexeme[2]=='e' && lexeme[3]=='n' && lexeme[4]=='\0') return 1;
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
             break;
     }
     return 0;
 }
 
-<<<<<<< HEAD
-int isNoiseWord(const char *lexeme) {
-    if (!lexeme || !lexeme[0]) return 0;
-    switch (lexeme[0]) {
-        case 'f': /* from */
-            if (lexeme[1]=='r' && lexeme[2]=='o' && lexeme[3]=='m' && lexeme[4]=='\0') return 1;
-            break;
-        case 't': /* then */
-            if (lexeme[1]=='h' && lexeme[2]=='e' && lexeme[3]=='n' && lexeme[4]=='\0') return 1;
-            break;
-        case 'w': /* with */
-=======
 int isReservedWord(const char *lexeme) {
     if (!lexeme || !lexeme[0]) return 0;
     switch (lexeme[0]) {
@@ -382,115 +247,91 @@ int isNoiseWord(const char *lexeme) {
             if (lexeme[1]=='h' && lexeme[2]=='e' && lexeme[3]=='n' && lexeme[4]=='\0') return 1;
             break;
         case 'w': // with
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
             if (lexeme[1]=='i' && lexeme[2]=='t' && lexeme[3]=='h' && lexeme[4]=='\0') return 1;
             break;
     }
     return 0;
 }
 
+
 /* ============================
-   GET NEXT TOKEN
+   LITERAL SCANNING
    ============================ */
-<<<<<<< HEAD
-   
-Token getNextToken(Lexer *lexer) {
-    skipWhitespace(lexer);
-
-=======
-Token getNextToken(Lexer *lexer) {
-    /* Emit pending right-quote tokens first (if any) */
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
-    Token token;
-    token.lexeme = NULL;
-    token.type = TOKEN_UNKNOWN;
-
-<<<<<<< HEAD
-    char c = lexer->currentChar;
-
-    if (c == '\0') {
-        token.type = TOKEN_EOF;
-        token.lexeme = (char *)malloc(4);
-        strcpy(token.lexeme, "EOF");
-        return token;
-    }
-
-    if (c == '/') {
-        char nextChar = lexer->source[lexer->position + 1];
-        if (nextChar == '/') {
-            // Line comment
-            advance(lexer); advance(lexer); // skip "//"
-=======
-    if (lexer->pendingRightStringQuote) {
-        /* currentChar should be '"' if well-formed */
-        token.lexeme = (char *)malloc(2); token.lexeme[0] = '"'; token.lexeme[1] = '\0';
-        token.type = TOKEN_RIGHT_STRING_QUOTATION;
-        lexer->pendingRightStringQuote = 0;
-        /* consume closing quote */
-        if (lexer->currentChar == '"') advance(lexer);
-        return token;
-    }
-    if (lexer->pendingRightCharQuote) {
-        token.lexeme = (char *)malloc(2); token.lexeme[0] = '\''; token.lexeme[1] = '\0';
-        token.type = TOKEN_RIGHT_CHAR_QUOTATION;
-        lexer->pendingRightCharQuote = 0;
-        if (lexer->currentChar == '\'') advance(lexer);
-        return token;
-    }
-
-    /* If we are inside a previously-opened string, return only the content token (do NOT consume closing quote) */
-    if (lexer->inStringContent) {
-        int start = lexer->position;
-        while (lexer->currentChar != '\0') {
-            if (lexer->currentChar == '\\' && peek(lexer) != '\0') {
-                /* include escaped char in the content */
-                advance(lexer); advance(lexer);
-                continue;
-            }
-            if (lexer->currentChar == '"') {
-                /* stop before closing quote */
-                break;
-            }
+/* Scan a whole "..." literal in one pass; currentChar is the opening quote.
+   No lexeme is copied: the content is the token span minus its quotes, and
+   escapes are only noted (TOKEN_FLAG_HAS_ESCAPES) for decodeLiteral. */
+static void scanStringLiteral(Lexer *lexer, Token *token) {
+    advance(lexer); // consume opening quote
+    int atLine = (lexer->recovery == LEXER_RECOVER_AT_LINE);
+    while (lexer->currentChar != '\0' && lexer->currentChar != '"') {
+        if (atLine && lexer->currentChar == '\n') break; // unclosed: stop at the line end
+        if (lexer->currentChar == '\\' && peek(lexer) != '\0' && !(atLine && peek(lexer) == '\n')) {
+            /* include escaped char in the content */
+            token->flags |= TOKEN_FLAG_HAS_ESCAPES;
             advance(lexer);
         }
-        int len = lexer->position - start;
-        token.lexeme = (char *)malloc(len + 1);
-        for (int i = 0; i < len; i++) token.lexeme[i] = lexer->source[start + i];
-        token.lexeme[len] = '\0';
-        token.type = TOKEN_STRING_LITERAL;
-        lexer->inStringContent = 0;
-        lexer->pendingRightStringQuote = (lexer->currentChar == '"') ? 1 : 0;
-        return token;
+        advance(lexer);
     }
+    token->type = TOKEN_STRING_LITERAL;
+    if (lexer->currentChar == '"') advance(lexer); // consume closing quote
+    else token->flags |= TOKEN_FLAG_UNTERMINATED;
+}
 
-    /* If we are inside a previously-opened char, return the CHAR_LITERAL (do NOT consume closing ') */
-    if (lexer->inCharContent) {
-        int start = lexer->position;
-        if (lexer->currentChar == '\\' && peek(lexer) != '\0') {
-            advance(lexer); advance(lexer);
-        } else {
-            if (lexer->currentChar != '\0') advance(lexer);
-        }
-        int len = lexer->position - start;
-        if (len < 0) len = 0;
-        token.lexeme = (char *)malloc(len + 1);
-        for (int i = 0; i < len; i++) token.lexeme[i] = lexer->source[start + i];
-        token.lexeme[len] = '\0';
-        token.type = TOKEN_CHAR_LITERAL;
-        lexer->inCharContent = 0;
-        lexer->pendingRightCharQuote = (lexer->currentChar == '\'') ? 1 : 0;
-        return token;
+/* Scan a '.' literal: one char or one escape (\\xNN takes its hex digits
+   too), then the closing quote. '' is an empty literal rather than a char
+   literal holding a quote. */
+static void scanCharLiteral(Lexer *lexer, Token *token) {
+    advance(lexer); // consume opening quote
+    int atLine = (lexer->recovery == LEXER_RECOVER_AT_LINE);
+    if (lexer->currentChar == '\\' && peek(lexer) != '\0' && !(atLine && peek(lexer) == '\n')) {
+        token->flags |= TOKEN_FLAG_HAS_ESCAPES;
+        advance(lexer);
+        int hex = (lexer->currentChar == 'x');
+        advance(lexer);
+        for (int i = 0; hex && i < 2 && isHexDigit(lexer->currentChar); i++) advance(lexer);
+    } else if (lexer->currentChar != '\0' && lexer->currentChar != '\'' && !(atLine && lexer->currentChar == '\n')) {
+        advance(lexer);
     }
+    token->type = TOKEN_CHAR_LITERAL;
+    if (lexer->currentChar == '\'') advance(lexer); // consume closing quote
+    else token->flags |= TOKEN_FLAG_UNTERMINATED;
+}
+
+
+/* ============================
+   GET NEXT TOKEN
+   ============================ */
+/* only tokens the caller asked for get a lexeme copy */
+static int keepLexeme(const Lexer *lexer, TokenType type) {
+    return lexer->copyLexemes && (lexer->want & TOKEN_BIT(type));
+}
 
-    /* Normal flow */
-    skipWhitespace(lexer);
+/* classify a word without copying it: nothing longer than "otherwise" can
+   be a keyword, reserved or noise word */
+static TokenType classifyWord(const char *s, int len) {
+    char word[16];
+    if (len >= (int)sizeof(word)) return TOKEN_IDENTIFIER;
+    memcpy(word, s, len);
+    word[len] = '\0';
+
+    /* check order: noise -> reserved -> keyword -> identifier */
+    if (isNoiseWord(word)) return TOKEN_NOISEWORD;
+    if (isReservedWord(word)) return TOKEN_RESERVEDWORD;
+    if (isKeyword(word)) return TOKEN_KEYWORD;
+    return TOKEN_IDENTIFIER;
+}
+
+static Token scanToken(Lexer *lexer) {
+    Token token;
+    token.lexeme = NULL;
+    token.type = TOKEN_UNKNOWN;
+    token.flags = 0;
 
     char c = lexer->currentChar;
 
     if (c == '\0') {
         token.type = TOKEN_EOF;
-        token.lexeme = (char *)malloc(4);
-        token.lexeme[0] = 'E'; token.lexeme[1] = 'O'; token.lexeme[2] = 'F'; token.lexeme[3] = '\0';
+        if (lexer->copyLexemes) token.lexeme = copyText(lexer, "EOF", 3);
         return token;
     }
 
@@ -500,173 +341,80 @@ Token getNextToken(Lexer *lexer) {
         if (nextChar == '/') {
             // Line comment: consume '//', then until newline or EOF
             advance(lexer); advance(lexer); // skip '/'
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
             int start = lexer->position;
             while (lexer->currentChar != '\0' && lexer->currentChar != '\n') advance(lexer);
-            int len = lexer->position - start;
-            token.lexeme = (char *)malloc(len + 1);
-            for (int i = 0; i < len; i++) token.lexeme[i] = lexer->source[start + i];
-            token.lexeme[len] = '\0';
             token.type = TOKEN_LINE_COMMENT;
+            if (keepLexeme(lexer, token.type)) copyLexeme(lexer, &token, start, lexer->position - start);
             return token;
         } else if (nextChar == '*') {
-<<<<<<< HEAD
-            // Block comment
-            advance(lexer); advance(lexer); // skip "/*"
-            int start = lexer->position;
-            while (!(lexer->currentChar == '*' && lexer->source[lexer->position + 1] == '/') && lexer->currentChar != '\0') advance(lexer);
-=======
             // Block comment: consume '/*' ... '*/'
             advance(lexer); advance(lexer); // skip '/*'
             int start = lexer->position;
-            while (!(lexer->currentChar == '*' && peek(lexer) == '/') && lexer->currentChar != '\0') {
+            /* once a search for the closer has failed, nothing later closes
+               either, so at-line recovery never rescans the file */
+            int knownOpen = (lexer->noCommentClose >= 0 && start >= lexer->noCommentClose);
+            while (!knownOpen && !(lexer->currentChar == '*' && peek(lexer) == '/') && lexer->currentChar != '\0') {
                 advance(lexer);
             }
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
-            int len = lexer->position - start;
-            token.lexeme = (char *)malloc(len + 1);
-            for (int i = 0; i < len; i++) token.lexeme[i] = lexer->source[start + i];
-            token.lexeme[len] = '\0';
             token.type = TOKEN_BLOCK_COMMENT;
-<<<<<<< HEAD
-            if (lexer->currentChar != '\0') { advance(lexer); advance(lexer); } // skip "*/"
-            return token;
-        }
-    }
-    if (c == '\0') {
-        token.type = TOKEN_EOF;
-        return token;
-    }
-
-    /* Identifiers / Keywords / Reserved / Noise */
-=======
-            if (lexer->currentChar != '\0') { advance(lexer); advance(lexer); } // skip '*/'
+            if (knownOpen || lexer->currentChar == '\0') {
+                token.flags |= TOKEN_FLAG_UNTERMINATED;
+                if (!knownOpen) lexer->noCommentClose = start;
+                const char *eol = NULL;
+                if (lexer->recovery == LEXER_RECOVER_AT_LINE) eol = strchr(lexer->source + start, '\n');
+                if (eol) seek(lexer, (int)(eol - lexer->source));
+                else while (lexer->currentChar != '\0') advance(lexer);
+            }
+            if (keepLexeme(lexer, token.type)) copyLexeme(lexer, &token, start, lexer->position - start);
+            if (!(token.flags & TOKEN_FLAG_UNTERMINATED)) { advance(lexer); advance(lexer); } // skip '*/'
             return token;
         }
     }
 
-    /* QUOTE DELIMITERS: opening quotes create delimiter tokens and enter content mode */
+    /* STRING / CHAR LITERALS: one token spanning both quotes */
     if (c == '"') {
-        token.lexeme = (char *)malloc(2); token.lexeme[0] = '"'; token.lexeme[1] = '\0';
-        token.type = TOKEN_LEFT_STRING_QUOTATION;
-        advance(lexer); /* consume opening quote */
-        lexer->inStringContent = 1;
-        lexer->pendingRightStringQuote = 0;
+        scanStringLiteral(lexer, &token);
         return token;
     }
     if (c == '\'') {
-        token.lexeme = (char *)malloc(2); token.lexeme[0] = '\''; token.lexeme[1] = '\0';
-        token.type = TOKEN_LEFT_CHAR_QUOTATION;
-        advance(lexer); /* consume opening quote */
-        lexer->inCharContent = 1;
-        lexer->pendingRightCharQuote = 0;
+        scanCharLiteral(lexer, &token);
         return token;
     }
 
+    int start = lexer->position;
+
     /* IDENTIFIERS / KEYWORD / RESERVED / NOISE */
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
     if (isAlpha(c)) {
-        int start = lexer->position;
         while (isAlpha(lexer->currentChar) || isDigit(lexer->currentChar)) {
             advance(lexer);
         }
         int len = lexer->position - start;
-        token.lexeme = (char *)malloc(len + 1);
-<<<<<<< HEAD
-        for (int i = 0; i < len; i++) {
-            token.lexeme[i] = lexer->source[start + i];
-        }
-        token.lexeme[len] = '\0';
-
-        if (isKeyword(token.lexeme)) token.type = TOKEN_KEYWORD;
-        else if (isReservedWord(token.lexeme)) token.type = TOKEN_RESERVEDWORD;
-        else if (isNoiseWord(token.lexeme)) token.type = TOKEN_NOISEWORD;
-=======
-        for (int i = 0; i < len; i++) token.lexeme[i] = lexer->source[start + i];
-        token.lexeme[len] = '\0';
-
-        /* check order: noise -> reserved -> keyword -> identifier */
-        if (isNoiseWord(token.lexeme)) token.type = TOKEN_NOISEWORD;
-        else if (isReservedWord(token.lexeme)) token.type = TOKEN_RESERVEDWORD;
-        else if (isKeyword(token.lexeme)) token.type = TOKEN_KEYWORD;
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
-        else token.type = TOKEN_IDENTIFIER;
 
+        /* no word category requested: skip the keyword lookup entirely */
+        if (!(lexer->want & TOKEN_WORD_MASK)) token.type = TOKEN_IDENTIFIER;
+        else token.type = classifyWord(lexer->source + start, len);
+
+        if (keepLexeme(lexer, token.type)) copyLexeme(lexer, &token, start, len);
         return token;
     }
 
-<<<<<<< HEAD
-    /* Numbers */
-    if (isDigit(c)) {
-        int start = lexer->position;
-        int hasDot = 0;
-        while (isDigit(lexer->currentChar) || (lexer->currentChar=='.' && !hasDot)) {
-            if (lexer->currentChar=='.') hasDot = 1;
-=======
     /* NUMBERS: INT or FLOAT */
     if (isDigit(c)) {
-        int start = lexer->position;
         int hasDot = 0;
         while (isDigit(lexer->currentChar) || (lexer->currentChar == '.' && !hasDot)) {
             if (lexer->currentChar == '.') {
                 hasDot = 1;
             }
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
             advance(lexer);
         }
-        int len = lexer->position - start;
-        token.lexeme = (char *)malloc(len + 1);
-<<<<<<< HEAD
-        for (int i=0; i<len; i++) token.lexeme[i] = lexer->source[start + i];
-=======
-        for (int i = 0; i < len; i++) token.lexeme[i] = lexer->source[start + i];
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
-        token.lexeme[len] = '\0';
         token.type = hasDot ? TOKEN_FLOAT_LITERAL : TOKEN_INT_LITERAL;
+        if (keepLexeme(lexer, token.type)) copyLexeme(lexer, &token, start, lexer->position - start);
         return token;
     }
 
-<<<<<<< HEAD
-    /* Strings */
-    if (c == '"') {
-        advance(lexer); // skip "
-        int start = lexer->position;
-        while (lexer->currentChar != '"' && lexer->currentChar != '\0') advance(lexer);
-        int len = lexer->position - start;
-        token.lexeme = (char *)malloc(len + 1);
-        for (int i=0; i<len; i++) token.lexeme[i] = lexer->source[start + i];
-        token.lexeme[len] = '\0';
-        token.type = TOKEN_STRING_LITERAL;
-        advance(lexer); // skip closing "
-        return token;
-    }
-
-    /* Delimiters */
-    if (isDelimiter(c)) {
-        advance(lexer);
-        token.lexeme = (char *)malloc(2);
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
-
-        switch(c) {
-            case '(': token.type = TOKEN_LEFT_PARENTHESIS; break;
-            case ')': token.type = TOKEN_RIGHT_PARENTHESIS; break;
-            case '{': token.type = TOKEN_LEFT_BRACE; break;
-            case '}': token.type = TOKEN_RIGHT_BRACE; break;
-            case '[': token.type = TOKEN_LEFT_BRACKET; break;
-            case ']': token.type = TOKEN_RIGHT_BRACKET; break;
-            case ',': token.type = TOKEN_COMMA; break;
-            case ';': token.type = TOKEN_SEMICOLON; break;
-            // case '.': token.type = TOKEN_DOT; break;
-            case ':': token.type = TOKEN_COLON; break;
-            case '"': token.type = TOKEN_STRING_QUOTATION; break;
-            case '\'': token.type = TOKEN_CHAR_QUOTATION; break;
-=======
     /* DELIMITERS (not quotes) */
     if (isDelimiterChar(c)) {
         advance(lexer);
-        token.lexeme = (char *)malloc(2);
-        token.lexeme[0] = c; token.lexeme[1] = '\0';
         switch (c) {
             case '(' : token.type = TOKEN_LEFT_PARENTHESIS; break;
             case ')' : token.type = TOKEN_RIGHT_PARENTHESIS; break;
@@ -679,119 +427,14 @@ Token getNextToken(Lexer *lexer) {
             case ':' : token.type = TOKEN_COLON; break;
             case '.' : token.type = TOKEN_DOT; break;
             default: token.type = TOKEN_UNKNOWN; break;
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
         }
+        if (keepLexeme(lexer, token.type)) copyLexeme(lexer, &token, start, 1);
         return token;
     }
 
-<<<<<<< HEAD
-    /* Operators (single-char) */
-    if (isOperator(c)) {
-    char nextChar = lexer->source[lexer->position + 1];
-
-    token.lexeme = (char *)malloc(3);
-    token.lexeme[0] = c;
-    token.lexeme[1] = '\0';
-
-    int twoChar = 0; // flag for two-character operator
-
-    /* Detect two-character operators */
-    switch (c) {
-        case '+':
-            if (nextChar == '+' || nextChar == '=') twoChar = 1;
-            break;
-
-        case '-':
-            if (nextChar == '-' || nextChar == '=') twoChar = 1;
-            break;
-
-        case '*':
-            if (nextChar == '=') twoChar = 1;
-            break;
-
-        case '/':
-            if (nextChar == '=') twoChar = 1;
-            break;
-
-        case '%':
-            if (nextChar == '=') twoChar = 1;
-            break;
-
-        case '=':
-            if (nextChar == '=') twoChar = 1;
-            break;
-
-        case '!':
-            if (nextChar == '=') twoChar = 1;
-            break;
-
-        case '<':
-            if (nextChar == '=') twoChar = 1;
-            break;
-
-        case '>':
-            if (nextChar == '=') twoChar = 1;
-            break;
-        case '&':
-            if (nextChar == '&') twoChar = 1;
-            break;
-        case '|':
-            if (nextChar == '|') twoChar = 1;
-            break;
-    }
-
-    /* Build lexeme if two-character operator */
-    if (twoChar) {
-        token.lexeme[1] = nextChar;
-        token.lexeme[2] = '\0';
-        advance(lexer); // consume second character
-    }
-
-    advance(lexer); // consume first character
-
-    /* Assign token type */
-    if (c == '+' && nextChar == '+') token.type = TOKEN_INCREMENT_OPERATOR;
-    else if (c == '-' && nextChar == '-') token.type = TOKEN_DECREMENT_OPERATOR;
-    else if (c == '+' && nextChar == '=') token.type = TOKEN_PLUS_ASSIGN_OPERATOR;
-    else if (c == '-' && nextChar == '=') token.type = TOKEN_MINUS_ASSIGN_OPERATOR;
-    else if (c == '*' && nextChar == '=') token.type = TOKEN_MULTIPLY_ASSIGN_OPERATOR;
-    else if (c == '/' && nextChar == '=') token.type = TOKEN_DIVIDE_ASSIGN_OPERATOR;
-    else if (c == '%' && nextChar == '=') token.type = TOKEN_MODULO_ASSIGN_OPERATOR;
-    else if (c == '=' && nextChar == '=') token.type = TOKEN_EQUAL_OPERATOR;
-    else if (c == '!' && nextChar == '=') token.type = TOKEN_NOT_EQUAL_OPERATOR;
-    else if (c == '<' && nextChar == '=') token.type = TOKEN_LESS_EQUAL_OPERATOR;
-    else if (c == '>' && nextChar == '=') token.type = TOKEN_GREATER_EQUAL_OPERATOR;
-    else if (c == '&' && nextChar == '&') token.type = TOKEN_LOGICAL_AND_OPERATOR;
-    else if (c == '|' && nextChar == '|') token.type = TOKEN_LOGICAL_OR_OPERATOR;
-
-    /* Single-character operators */
-    else {
-        switch (c) {
-            case '+': token.type = TOKEN_PLUS_OPERATOR; break;
-            case '-': token.type = TOKEN_MINUS_OPERATOR; break;
-            case '*': token.type = TOKEN_MULTIPLY_OPERATOR; break;
-            case '/': token.type = TOKEN_DIVIDE_OPERATOR; break;
-            case '%': token.type = TOKEN_MODULO_OPERATOR; break;
-            case '=': token.type = TOKEN_ASSIGN_OPERATOR; break;
-            case '!': token.type = TOKEN_LOGICAL_NOT_OPERATOR; break;
-            case '<': token.type = TOKEN_LESS_THAN_OPERATOR; break;
-            case '>': token.type = TOKEN_GREATER_THAN_OPERATOR; break;
-        }
-    }
-
-    return token;
-}
-
-    /* Unknown character */
-=======
     /* OPERATORS (single and two-character) */
     if (isOperatorChar(c)) {
         char next = peek(lexer);
-        // prepare lexeme buffer (max 3 chars)
-        token.lexeme = (char *)malloc(3);
-        token.lexeme[0] = c;
-        token.lexeme[1] = '\0';
-
         int twoChar = 0;
 
         switch (c) {
@@ -809,30 +452,31 @@ Token getNextToken(Lexer *lexer) {
         }
 
         if (twoChar) {
-            token.lexeme[1] = next; token.lexeme[2] = '\0';
             advance(lexer); // consume second char
+        } else {
+            next = '\0';
         }
         advance(lexer); // consume first (or only) char
 
         // assign token type based on characters (explicit)
-        if (token.lexeme[0] == '+' && token.lexeme[1] == '+') token.type = TOKEN_INCREMENT_OPERATOR;
-        else if (token.lexeme[0] == '-' && token.lexeme[1] == '-') token.type = TOKEN_DECREMENT_OPERATOR;
-        else if (token.lexeme[0] == '+' && token.lexeme[1] == '=') token.type = TOKEN_PLUS_ASSIGN_OPERATOR;
-        else if (token.lexeme[0] == '-' && token.lexeme[1] == '=') token.type = TOKEN_MINUS_ASSIGN_OPERATOR;
-        else if (token.lexeme[0] == '*' && token.lexeme[1] == '=') token.type = TOKEN_MULTIPLY_ASSIGN_OPERATOR;
-        else if (token.lexeme[0] == '*' && token.lexeme[1] == '*') token.type = TOKEN_EXPONENT_OPERATOR;
-        else if (token.lexeme[0] == '/' && token.lexeme[1] == '=') token.type = TOKEN_DIVIDE_ASSIGN_OPERATOR;
-        else if (token.lexeme[0] == '%' && token.lexeme[1] == '=') token.type = TOKEN_MODULO_ASSIGN_OPERATOR;
-        else if (token.lexeme[0] == '=' && token.lexeme[1] == '=') token.type = TOKEN_EQUAL_OPERATOR;
-        else if (token.lexeme[0] == '!' && token.lexeme[1] == '=') token.type = TOKEN_NOT_EQUAL_OPERATOR;
-        else if (token.lexeme[0] == '<' && token.lexeme[1] == '=') token.type = TOKEN_LESS_EQUAL_OPERATOR;
-        else if (token.lexeme[0] == '>' && token.lexeme[1] == '=') token.type = TOKEN_GREATER_EQUAL_OPERATOR;
-        else if (token.lexeme[0] == '&' && token.lexeme[1] == '&') token.type = TOKEN_LOGICAL_AND_OPERATOR;
-        else if (token.lexeme[0] == '|' && token.lexeme[1] == '|') token.type = TOKEN_LOGICAL_OR_OPERATOR;
+        if (c == '+' && next == '+') token.type = TOKEN_INCREMENT_OPERATOR;
+        else if (c == '-' && next == '-') token.type = TOKEN_DECREMENT_OPERATOR;
+        else if (c == '+' && next == '=') token.type = TOKEN_PLUS_ASSIGN_OPERATOR;
+        else if (c == '-' && next == '=') token.type = TOKEN_MINUS_ASSIGN_OPERATOR;
+        else if (c == '*' && next == '=') token.type = TOKEN_MULTIPLY_ASSIGN_OPERATOR;
+        else if (c == '*' && next == '*') token.type = TOKEN_EXPONENT_OPERATOR;
+        else if (c == '/' && next == '=') token.type = TOKEN_DIVIDE_ASSIGN_OPERATOR;
+        else if (c == '%' && next == '=') token.type = TOKEN_MODULO_ASSIGN_OPERATOR;
+        else if (c == '=' && next == '=') token.type = TOKEN_EQUAL_OPERATOR;
+        else if (c == '!' && next == '=') token.type = TOKEN_NOT_EQUAL_OPERATOR;
+        else if (c == '<' && next == '=') token.type = TOKEN_LESS_EQUAL_OPERATOR;
+        else if (c == '>' && next == '=') token.type = TOKEN_GREATER_EQUAL_OPERATOR;
+        else if (c == '&' && next == '&') token.type = TOKEN_LOGICAL_AND_OPERATOR;
+        else if (c == '|' && next == '|') token.type = TOKEN_LOGICAL_OR_OPERATOR;
 
         else {
             // single-char operators
-            switch (token.lexeme[0]) {
+            switch (c) {
                 case '+' : token.type = TOKEN_PLUS_OPERATOR; break;
                 case '-' : token.type = TOKEN_MINUS_OPERATOR; break;
                 case '*' : token.type = TOKEN_MULTIPLY_OPERATOR; break;
@@ -846,19 +490,724 @@ Token getNextToken(Lexer *lexer) {
                 default: token.type = TOKEN_UNKNOWN; break;
             }
         }
+        if (keepLexeme(lexer, token.type)) copyLexeme(lexer, &token, start, lexer->position - start);
         return token;
     }
 
     /* UNKNOWN CHARACTER - return as TOKEN_UNKNOWN with lexeme */
->>>>>>> 71357cbde31b7a0029e199cbce994f014b3fde10
-    token.lexeme = (char *)malloc(2);
-    token.lexeme[0] = c;
-    token.lexeme[1] = '\0';
     advance(lexer);
     token.type = TOKEN_UNKNOWN;
+    if (keepLexeme(lexer, token.type)) copyLexeme(lexer, &token, start, 1);
     return token;
 }
 
+static void noteBracket(Lexer *lexer, const Token *token);
+
+/* Tokens whose type is filtered out by setTokenFilter are scanned past
+   without a lexeme copy and never returned; EOF always comes through. */
+static Token nextToken(Lexer *lexer) {
+    for (;;) {
+        skipWhitespace(lexer);
+        int start = lexer->position;
+        Token token = scanToken(lexer);
+        if (!(lexer->want & TOKEN_BIT(token.type)) && token.type != TOKEN_EOF) continue;
+        token.start = start;
+        token.length = lexer->position - start;
+        return token;
+    }
+}
+
+Token getNextToken(Lexer *lexer) {
+    Token token = nextToken(lexer);
+    if (lexer->brackets) noteBracket(lexer, &token);
+    return token;
+}
+
+
+/* ============================
+   LEGACY QUOTE OUTPUT
+   ============================ */
+static Token makeQuoteToken(Lexer *lexer, TokenType type, char quote, int start) {
+    Token token;
+    token.type = type;
+    token.lexeme = copyText(lexer, &quote, 1);
+    token.start = start;
+    token.length = 1;
+    token.flags = 0;
+    return token;
+}
+
+/* Coursework dump format: every literal comes out as three tokens,
+   LEFT_*_QUOTATION, the content, then RIGHT_*_QUOTATION (omitted when the
+   literal is unterminated). Splits the single token from getNextToken, so
+   the scanner itself never carries quote state between calls. */
+static Token nextLegacyToken(Lexer *lexer) {
+    if (lexer->pendingCount > 0) {
+        Token token = lexer->pending[lexer->pendingHead];
+        lexer->pendingHead++;
+        lexer->pendingCount--;
+        return token;
+    }
+
+    Token token = nextToken(lexer);
+    if (token.type != TOKEN_STRING_LITERAL && token.type != TOKEN_CHAR_LITERAL) return token;
+
+    int isString = (token.type == TOKEN_STRING_LITERAL);
+    char quote = isString ? '"' : '\'';
+    int terminated = !(token.flags & TOKEN_FLAG_UNTERMINATED);
+
+    Token content = token; // keeps the literal's UNTERMINATED / HAS_ESCAPES flags
+    content.start = token.start + 1;
+    content.length = token.length - 1 - terminated;
+    copyLexeme(lexer, &content, content.start, content.length);
+
+    lexer->pendingHead = 0;
+    lexer->pendingCount = 0;
+    lexer->pending[lexer->pendingCount++] = content;
+    if (terminated) {
+        lexer->pending[lexer->pendingCount++] = makeQuoteToken(lexer,
+            isString ? TOKEN_RIGHT_STRING_QUOTATION : TOKEN_RIGHT_CHAR_QUOTATION,
+            quote, token.start + token.length - 1);
+    }
+    return makeQuoteToken(lexer, isString ? TOKEN_LEFT_STRING_QUOTATION : TOKEN_LEFT_CHAR_QUOTATION,
+                          quote, token.start);
+}
+
+Token getNextLegacyToken(Lexer *lexer) {
+    Token token = nextLegacyToken(lexer);
+    if (lexer->brackets) noteBracket(lexer, &token);
+    return token;
+}
+
+/* release a token's lexeme through the allocator that produced it */
+void freeToken(Lexer *lexer, Token *token) {
+    if (token->lexeme) lexer->allocator.release(token->lexeme, lexer->allocator.ctx);
+    token->lexeme = NULL;
+}
+
+
+/* ============================
+   BRACKET INDEX
+   ============================ */
+void initBracketIndex(BracketIndex *index, const LexerAllocator *allocator) {
+    memset(index, 0, sizeof(*index));
+    setAllocator(&index->allocator, allocator);
+}
+
+/* index counts tokens from the next one the lexer returns */
+void trackBrackets(Lexer *lexer, BracketIndex *index) {
+    lexer->brackets = index;
+}
+
+void freeBracketIndex(BracketIndex *index) {
+    LexerAllocator *a = &index->allocator;
+    if (index->partner) a->release(index->partner, a->ctx);
+    if (index->open) a->release(index->open, a->ctx);
+    if (index->issues) a->release(index->issues, a->ctx);
+    index->partner = NULL; index->open = NULL; index->issues = NULL;
+    index->count = index->capacity = index->depth = index->openCap = 0;
+    index->issueCount = index->issueCap = 0;
+}
+
+/* make room for one more element; the allocator has no realloc */
+static int reserveOne(const LexerAllocator *a, void **items, int count, int *cap, size_t size) {
+    if (count < *cap) return 1;
+    int grown = *cap ? *cap * 2 : 256;
+    void *p = a->alloc(size * grown, a->ctx);
+    if (!p) return 0;
+    if (*items) {
+        memcpy(p, *items, size * count);
+        a->release(*items, a->ctx);
+    }
+    *items = p;
+    *cap = grown;
+    return 1;
+}
+
+/* 0 for ( ), 1 for { }, 2 for [ ], -1 for any other token */
+static int bracketKind(TokenType t) {
+    switch (t) {
+        case TOKEN_LEFT_PARENTHESIS: case TOKEN_RIGHT_PARENTHESIS: return 0;
+        case TOKEN_LEFT_BRACE:       case TOKEN_RIGHT_BRACE:       return 1;
+        case TOKEN_LEFT_BRACKET:     case TOKEN_RIGHT_BRACKET:     return 2;
+        default: return -1;
+    }
+}
+
+static void addDelimiterIssue(BracketIndex *bi, DelimiterIssueKind kind, TokenType type, int token, int start) {
+    if (!reserveOne(&bi->allocator, (void **)&bi->issues, bi->issueCount, &bi->issueCap, sizeof(DelimiterIssue))) {
+        bi->failed = 1;
+        return;
+    }
+    DelimiterIssue *issue = &bi->issues[bi->issueCount++];
+    issue->kind = kind;
+    issue->type = type;
+    issue->token = token;
+    issue->start = start;
+}
+
+static void popUnclosed(BracketIndex *bi) {
+    OpenDelimiter *o = &bi->open[--bi->depth];
+    bi->openOfType[bracketKind(o->type)]--;
+    addDelimiterIssue(bi, DELIM_UNCLOSED, o->type, o->token, o->start);
+}
+
+/* One step per returned token. A closer with no opener of its kind open is
+   rejected from the per-kind count without searching the stack, and every
+   opener is popped at most once, so the whole pass stays linear. */
+static void noteBracket(Lexer *lexer, const Token *token) {
+    BracketIndex *bi = lexer->brackets;
+    if (bi->failed) return;
+    if (!reserveOne(&bi->allocator, (void **)&bi->partner, bi->count, &bi->capacity, sizeof(int))) {
+        bi->failed = 1;
+        return;
+    }
+    int index = bi->count++;
+    bi->partner[index] = -1;
+
+    if (token->type == TOKEN_EOF) {
+        while (bi->depth > 0) popUnclosed(bi);
+        return;
+    }
+    int kind = bracketKind(token->type);
+    if (kind < 0) return;
+
+    if (token->type == TOKEN_LEFT_PARENTHESIS || token->type == TOKEN_LEFT_BRACE ||
+        token->type == TOKEN_LEFT_BRACKET) {
+        if (!reserveOne(&bi->allocator, (void **)&bi->open, bi->depth, &bi->openCap, sizeof(OpenDelimiter))) {
+            bi->failed = 1;
+            return;
+        }
+        OpenDelimiter *o = &bi->open[bi->depth++];
+        o->type = token->type;
+        o->token = index;
+        o->start = token->start;
+        bi->openOfType[kind]++;
+        if (bi->depth > bi->maxDepth) bi->maxDepth = bi->depth;
+        return;
+    }
+
+    if (bi->openOfType[kind] == 0) {
+        addDelimiterIssue(bi, DELIM_STRAY, token->type, index, token->start);
+        return;
+    }
+    while (bracketKind(bi->open[bi->depth - 1].type) != kind) popUnclosed(bi);
+    OpenDelimiter *o = &bi->open[--bi->depth];
+    bi->openOfType[kind]--;
+    bi->partner[index] = o->token;
+    bi->partner[o->token] = index;
+    bi->pairs++;
+}
+
+
+/* ============================
+   ARENA ALLOCATOR
+   ============================ */
+#define ARENA_BLOCK_SIZE 4096
+
+void initLexerArena(LexerArena *arena) {
+    initLexerArenaWith(arena, NULL);
+}
+
+void initLexerArenaWith(LexerArena *arena, const LexerAllocator *allocator) {
+    arena->head = NULL;
+    setAllocator(&arena->allocator, allocator);
+}
+
+void *lexerArenaAlloc(LexerArena *arena, size_t size) {
+    size = (size + 7) & ~(size_t)7; // keep 8-byte alignment
+    LexerArenaBlock *b = arena->head;
+    if (!b || b->size - b->used < size) {
+        size_t cap = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        b = (LexerArenaBlock *)arena->allocator.alloc(sizeof(LexerArenaBlock) + cap, arena->allocator.ctx);
+        if (!b) return NULL;
+        b->next = arena->head;
+        b->used = 0;
+        b->size = cap;
+        arena->head = b;
+    }
+    void *p = b->data + b->used;
+    b->used += size;
+    return p;
+}
+
+void freeLexerArena(LexerArena *arena) {
+    LexerArenaBlock *b = arena->head;
+    while (b) {
+        LexerArenaBlock *next = b->next;
+        arena->allocator.release(b, arena->allocator.ctx);
+        b = next;
+    }
+    arena->head = NULL;
+}
+
+
+/* ============================
+   LITERAL DECODING
+   ============================ */
+/* Content of a STRING/CHAR literal token as written in the source: a view
+   into the source with the quotes stripped, escapes left undecoded. */
+const char *literalRaw(const char *source, const Token *token, int *len) {
+    int closing = (token->flags & TOKEN_FLAG_UNTERMINATED) ? 0 : 1;
+    *len = token->length - 1 - closing;
+    return source + token->start + 1;
+}
+
+void initLiteralCache(LiteralCache *cache) {
+    initLiteralCacheWith(cache, NULL);
+}
+
+/* slots and decoded text both come from allocator (NULL: malloc/free) */
+void initLiteralCacheWith(LiteralCache *cache, const LexerAllocator *allocator) {
+    initLexerArenaWith(&cache->arena, allocator);
+    cache->source = NULL;
+    cache->slots = NULL;
+    cache->capacity = 0;
+    cache->count = 0;
+}
+
+void freeLiteralCache(LiteralCache *cache) {
+    if (cache->slots) cache->arena.allocator.release(cache->slots, cache->arena.allocator.ctx);
+    freeLexerArena(&cache->arena);
+    cache->source = NULL;
+    cache->slots = NULL;
+    cache->capacity = 0;
+    cache->count = 0;
+}
+
+static DecodedLiteral *literalSlot(DecodedLiteral *slots, int capacity, int start) {
+    unsigned h = (unsigned)start * 2654435761u;
+    int i = (int)(h & (unsigned)(capacity - 1));
+    while (slots[i].start != -1 && slots[i].start != start) i = (i + 1) & (capacity - 1);
+    return &slots[i];
+}
+
+static int growLiteralCache(LiteralCache *cache) {
+    int cap = cache->capacity ? cache->capacity * 2 : 64;
+    const LexerAllocator *a = &cache->arena.allocator;
+    DecodedLiteral *slots = (DecodedLiteral *)a->alloc(sizeof(DecodedLiteral) * cap, a->ctx);
+    if (!slots) return 0;
+    for (int i = 0; i < cap; i++) slots[i].start = -1;
+    for (int i = 0; i < cache->capacity; i++) {
+        if (cache->slots[i].start != -1) *literalSlot(slots, cap, cache->slots[i].start) = cache->slots[i];
+    }
+    if (cache->slots) a->release(cache->slots, a->ctx);
+    cache->slots = slots;
+    cache->capacity = cap;
+    return 1;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+/* Decode raw literal content into out (at least len bytes). Accepts
+   \n \t \\ \" \' \0 and \xNN; returns the decoded length or -1. */
+static int decodeEscapes(const char *raw, int len, char *out) {
+    int n = 0;
+    for (int i = 0; i < len; i++) {
+        if (raw[i] != '\\') { out[n++] = raw[i]; continue; }
+        if (++i >= len) return -1;
+        switch (raw[i]) {
+            case 'n' : out[n++] = '\n'; break;
+            case 't' : out[n++] = '\t'; break;
+            case '\\': out[n++] = '\\'; break;
+            case '"' : out[n++] = '"'; break;
+            case '\'': out[n++] = '\''; break;
+            case '0' : out[n++] = '\0'; break;
+            case 'x' :
+                if (i + 2 >= len || !isHexDigit(raw[i + 1]) || !isHexDigit(raw[i + 2])) return -1;
+                out[n++] = (char)(hexValue(raw[i + 1]) * 16 + hexValue(raw[i + 2]));
+                i += 2;
+                break;
+            default: return -1;
+        }
+    }
+    return n;
+}
+
+/* Value of a STRING/CHAR literal token. Literals without escapes come back
+   as a zero-copy view of the source (not null-terminated); escaped ones are
+   validated and decoded into the cache arena on first request and reused
+   afterwards. Returns 1 on success, 0 for a malformed escape sequence. */
+int decodeLiteral(LiteralCache *cache, const char *source, const Token *token,
+                  const char **text, int *len) {
+    if (!(token->flags & TOKEN_FLAG_HAS_ESCAPES)) {
+        *text = literalRaw(source, token, len);
+        return 1;
+    }
+
+    if (cache->source != source) {
+        if (cache->source) {
+            LexerAllocator allocator = cache->arena.allocator;
+            freeLiteralCache(cache);
+            initLiteralCacheWith(cache, &allocator);
+        }
+        cache->source = source;
+    }
+
+    if (cache->capacity) {
+        DecodedLiteral *hit = literalSlot(cache->slots, cache->capacity, token->start);
+        if (hit->start == token->start) {
+            *text = hit->text;
+            *len = hit->length;
+            return hit->valid;
+        }
+    }
+
+    int rawLen;
+    const char *raw = literalRaw(source, token, &rawLen);
+    char *buf = (char *)lexerArenaAlloc(&cache->arena, (size_t)rawLen + 1);
+    if (!buf) return 0;
+    int n = decodeEscapes(raw, rawLen, buf);
+    int valid = (n >= 0);
+    if (!valid) n = 0;
+    buf[n] = '\0';
+
+    if ((cache->count + 1) * 10 > cache->capacity * 7 && !growLiteralCache(cache)) return 0;
+    DecodedLiteral *slot = literalSlot(cache->slots, cache->capacity, token->start);
+    slot->start = token->start;
+    slot->length = n;
+    slot->valid = valid;
+    slot->text = buf;
+    cache->count++;
+
+    *text = buf;
+    *len = n;
+    return valid;
+}
+
+
+/* ============================
+   NAME TABLE
+   ============================ */
+void initLexerNameTable(LexerNameTable *table, const LexerAllocator *allocator) {
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
+    setAllocator(&table->allocator, allocator);
+}
+
+void freeLexerNameTable(LexerNameTable *table) {
+    if (table->slots) table->allocator.release(table->slots, table->allocator.ctx);
+    table->slots = NULL;
+    table->capacity = table->count = 0;
+}
+
+unsigned lexerNameHash(const char *key, int len) {
+    unsigned h = 2166136261u; // FNV-1a
+    for (int i = 0; i < len; i++) { h ^= (unsigned char)key[i]; h *= 16777619u; }
+    return h;
+}
+
+static LexerNameSlot *nameSlot(LexerNameSlot *slots, int capacity, const char *key, int len, unsigned h) {
+    int i = (int)(h & (unsigned)(capacity - 1));
+    while (slots[i].id != -1 &&
+           !(slots[i].hash == h && slots[i].len == len && memcmp(slots[i].key, key, len) == 0)) {
+        i = (i + 1) & (capacity - 1);
+    }
+    return &slots[i];
+}
+
+static int growNameTable(LexerNameTable *table) {
+    int capacity = table->capacity ? table->capacity * 2 : 256;
+    const LexerAllocator *a = &table->allocator;
+    LexerNameSlot *slots = (LexerNameSlot *)a->alloc(sizeof(LexerNameSlot) * capacity, a->ctx);
+    if (!slots) return 0;
+    for (int i = 0; i < capacity; i++) slots[i].id = -1;
+    for (int i = 0; i < table->capacity; i++) {
+        LexerNameSlot *old = &table->slots[i];
+        if (old->id != -1) *nameSlot(slots, capacity, old->key, old->len, old->hash) = *old;
+    }
+    if (table->slots) a->release(table->slots, a->ctx);
+    table->slots = slots;
+    table->capacity = capacity;
+    return 1;
+}
+
+int lexerNameIntern(LexerNameTable *table, const char *key, int len) {
+    if ((table->count + 1) * 10 > table->capacity * 7 && !growNameTable(table)) return -1;
+    unsigned h = lexerNameHash(key, len);
+    LexerNameSlot *slot = nameSlot(table->slots, table->capacity, key, len, h);
+    if (slot->id == -1) {
+        slot->key = key; slot->len = len; slot->hash = h;
+        slot->id = table->count++;
+    }
+    return slot->id;
+}
+
+int lexerNameFind(const LexerNameTable *table, const char *key, int len) {
+    if (!table->count) return -1;
+    return nameSlot(table->slots, table->capacity, key, len, lexerNameHash(key, len))->id;
+}
+
+
+/* ============================
+   SYMBOL TABLE
+   ============================ */
+/* name id for s[0..len), interning a copy on first sight; -1 when out of memory */
+static int internName(SymbolTable *st, const char *s, int len) {
+    int id = lexerNameFind(&st->nameTable, s, len);
+    if (id >= 0) return id;
+
+    char *copy = (char *)lexerArenaAlloc(&st->arena, (size_t)len + 1);
+    if (!copy ||
+        !reserveOne(&st->allocator, (void **)&st->names, st->nameCount, &st->nameCap, sizeof(*st->names)) ||
+        !reserveOne(&st->allocator, (void **)&st->binding, st->nameCount, &st->bindingCap, sizeof(*st->binding))) {
+        st->failed = 1;
+        return -1;
+    }
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    id = lexerNameIntern(&st->nameTable, copy, len);
+    if (id < 0) { st->failed = 1; return -1; }
+    st->nameCount++;
+    st->names[id] = copy;
+    st->binding[id] = -1;
+    return id;
+}
+
+static void addIssue(SymbolTable *st, SymbolIssueKind kind, int token, int line, int nameId, int other) {
+    if (!reserveOne(&st->allocator, (void **)&st->issues, st->issueCount, &st->issueCap, sizeof(SymbolIssue))) {
+        st->failed = 1;
+        return;
+    }
+    SymbolIssue *is = &st->issues[st->issueCount++];
+    is->kind = kind; is->token = token; is->line = line; is->nameId = nameId; is->other = other;
+}
+
+static void pushScope(SymbolTable *st, int closesLoop) {
+    if (!reserveOne(&st->allocator, (void **)&st->scopes, st->depth, &st->scopeCap, sizeof(SymbolScope))) {
+        st->failed = 1;
+        return;
+    }
+    st->scopes[st->depth].undoMark = st->undoCount;
+    st->scopes[st->depth].closesLoop = closesLoop;
+    st->depth++;
+}
+
+static void popScope(SymbolTable *st) {
+    if (st->depth == 0) return; // stray '}' - nothing to close
+    st->depth--;
+    int mark = st->scopes[st->depth].undoMark;
+    while (st->undoCount > mark) {
+        SymbolUndo *u = &st->undo[--st->undoCount];
+        st->binding[u->nameId] = u->previous;
+    }
+}
+
+static void declareSymbol(SymbolTable *st, int token, int line, const char *s, int len, int isFixed, int isLoopVar) {
+    int id = internName(st, s, len);
+    if (id < 0) return;
+    int prev = st->binding[id];
+    if (prev != -1 && token >= 0) {
+        if (st->symbols[prev].depth == st->depth) addIssue(st, SYM_REDECLARED, token, line, id, prev);
+        else addIssue(st, SYM_SHADOWS, token, line, id, prev);
+    }
+
+    if (!reserveOne(&st->allocator, (void **)&st->symbols, st->symbolCount, &st->symbolCap, sizeof(SymbolDecl)) ||
+        !reserveOne(&st->allocator, (void **)&st->undo, st->undoCount, &st->undoCap, sizeof(SymbolUndo))) {
+        st->failed = 1;
+        return;
+    }
+    int index = st->symbolCount++;
+    SymbolDecl *sym = &st->symbols[index];
+    sym->nameId = id; sym->declToken = token; sym->line = line;
+    sym->depth = st->depth; sym->isFixed = isFixed; sym->isLoopVar = isLoopVar;
+
+    st->undo[st->undoCount].nameId = id;
+    st->undo[st->undoCount].previous = prev;
+    st->undoCount++;
+    st->binding[id] = index;
+}
+
+void initSymbolTable(SymbolTable *st, const char *source, const LexerAllocator *allocator) {
+    memset(st, 0, sizeof(*st));
+    st->source = source;
+    setAllocator(&st->allocator, allocator);
+    initLexerArenaWith(&st->arena, allocator);
+    initLexerNameTable(&st->nameTable, allocator);
+    st->line = 1;
+    st->heldToken = -1;
+    st->lastUse = -1;
+    declareSymbol(st, -1, 0, "show", 4, 0, 0); // builtin output routine
+}
+
+void freeSymbolTable(SymbolTable *st) {
+    LexerAllocator *a = &st->allocator;
+    void *arrays[] = { st->names, st->binding, st->symbols, st->refs, st->issues,
+                       st->undo, st->scopes, st->bodies };
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        if (arrays[i]) a->release(arrays[i], a->ctx);
+    }
+    freeLexerNameTable(&st->nameTable);
+    freeLexerArena(&st->arena);
+    memset(st, 0, sizeof(*st));
+}
+
+static int lineAt(SymbolTable *st, int offset) {
+    while (st->lineOffset < offset) {
+        if (st->source[st->lineOffset] == '\n') st->line++;
+        st->lineOffset++;
+    }
+    return st->line;
+}
+
+/* word is a type/width keyword that starts a declaration */
+static int isTypeWord(const char *s, int len) {
+    return (len == 5 && memcmp(s, "digit", 5) == 0) ||
+           (len == 5 && memcmp(s, "indiv", 5) == 0) ||
+           (len == 4 && memcmp(s, "tiny", 4) == 0)  ||
+           (len == 5 && memcmp(s, "short", 5) == 0) ||
+           (len == 4 && memcmp(s, "long", 4) == 0)  ||
+           (len == 5 && memcmp(s, "large", 5) == 0);
+}
+
+static int isAssignment(TokenType t) {
+    return t == TOKEN_ASSIGN_OPERATOR || t == TOKEN_PLUS_ASSIGN_OPERATOR ||
+           t == TOKEN_MINUS_ASSIGN_OPERATOR || t == TOKEN_MULTIPLY_ASSIGN_OPERATOR ||
+           t == TOKEN_DIVIDE_ASSIGN_OPERATOR || t == TOKEN_MODULO_ASSIGN_OPERATOR ||
+           t == TOKEN_INCREMENT_OPERATOR || t == TOKEN_DECREMENT_OPERATOR;
+}
+
+static void flushHeldDeclaration(SymbolTable *st) {
+    if (st->heldToken < 0) return;
+    declareSymbol(st, st->heldToken, lineAt(st, st->heldStart), st->source + st->heldStart,
+                  st->heldLen, st->declFixed, st->loopState == 1);
+    st->heldToken = -1;
+    st->declPending = 0;
+    st->declFixed = 0;
+}
+
+/* Feed tokens in stream order; index is the token's position in that stream.
+   Declarations are a run of type words and/or `fixed` followed by a name
+   (`fixed text name`: a second identifier means the first was a type name).
+   `{`/`}` open and close scopes; a `cycle` header gets its own scope that
+   stays open until the loop body's closing brace. */
+void symbolsFeed(SymbolTable *st, const Token *tok, int index) {
+    if (st->failed) return;
+    const char *text = st->source + tok->start;
+    int len = tok->length;
+
+    /* one token of lookahead for a held declaration name */
+    if (st->heldToken >= 0) {
+        if (tok->type == TOKEN_IDENTIFIER) {
+            st->heldToken = index; st->heldStart = tok->start; st->heldLen = len;
+            flushHeldDeclaration(st);
+            st->lastUse = -1;
+            return;
+        }
+        flushHeldDeclaration(st);
+    }
+
+    int use = -1;
+    if (st->loopState == 2) {
+        /* the token after a cycle header: a braced body inherits the loop scope,
+           an unbraced one keeps it open until its statement ends */
+        st->loopState = 0;
+        if (tok->type == TOKEN_LEFT_BRACE) { pushScope(st, 1); st->lastUse = -1; return; }
+        if (!reserveOne(&st->allocator, (void **)&st->bodies, st->bodyCount, &st->bodyCap, sizeof(SymbolLoopBody))) {
+            st->failed = 1;
+            return;
+        }
+        st->bodies[st->bodyCount].depth = st->depth;
+        st->bodies[st->bodyCount].parenDepth = st->parenDepth;
+        st->bodies[st->bodyCount].line = lineAt(st, tok->start);
+        st->bodyCount++;
+    } else if (st->bodyCount > 0) {
+        int line = lineAt(st, tok->start);
+        while (st->bodyCount > 0) {
+            SymbolLoopBody *b = &st->bodies[st->bodyCount - 1];
+            if (st->depth != b->depth || st->parenDepth != b->parenDepth ||
+                (tok->type != TOKEN_RIGHT_BRACE && line <= b->line)) {
+                b->line = line;
+                break;
+            }
+            popScope(st); // the body (and any unbraced loop it was) has ended
+            st->bodyCount--;
+        }
+    }
+    if (tok->type == TOKEN_LEFT_PARENTHESIS) st->parenDepth++;
+
+    switch (tok->type) {
+        case TOKEN_KEYWORD:
+            if (len == 5 && memcmp(text, "cycle", 5) == 0) {
+                pushScope(st, 0);
+                st->loopState = 1;
+                st->loopParenDepth = st->parenDepth;
+            } else if (isTypeWord(text, len)) {
+                st->declPending = 1;
+            }
+            break;
+        case TOKEN_RESERVEDWORD:
+            if (len == 5 && memcmp(text, "fixed", 5) == 0) { st->declPending = 1; st->declFixed = 1; }
+            break;
+        case TOKEN_IDENTIFIER:
+            if (st->declPending) {
+                st->heldToken = index; st->heldStart = tok->start; st->heldLen = len;
+                break;
+            }
+            {
+                int id = internName(st, text, len);
+                if (id < 0) return;
+                int line = lineAt(st, tok->start);
+                if (st->binding[id] == -1) {
+                    addIssue(st, SYM_UNRESOLVED, index, line, id, -1);
+                } else {
+                    use = st->binding[id];
+                    if (!reserveOne(&st->allocator, (void **)&st->refs, st->refCount, &st->refCap, sizeof(SymbolRef))) {
+                        st->failed = 1;
+                        return;
+                    }
+                    st->refs[st->refCount].token = index;
+                    st->refs[st->refCount].line = line;
+                    st->refs[st->refCount].symbol = use;
+                    st->refCount++;
+                }
+            }
+            break;
+        case TOKEN_LEFT_BRACE:
+            pushScope(st, 0);
+            break;
+        case TOKEN_RIGHT_BRACE: {
+            int closesLoop = (st->depth > 0) && st->scopes[st->depth - 1].closesLoop;
+            popScope(st);
+            if (closesLoop) popScope(st);
+            break;
+        }
+        case TOKEN_RIGHT_PARENTHESIS:
+            if (st->parenDepth > 0) st->parenDepth--;
+            if (st->loopState == 1 && st->parenDepth == st->loopParenDepth) st->loopState = 2;
+            break;
+        default:
+            if (isAssignment(tok->type) && st->lastUse >= 0 && st->symbols[st->lastUse].isFixed) {
+                SymbolDecl *sym = &st->symbols[st->lastUse];
+                addIssue(st, SYM_FIXED_ASSIGN, index, lineAt(st, tok->start), sym->nameId, st->lastUse);
+            }
+            break;
+    }
+    while (tok->type == TOKEN_SEMICOLON && st->bodyCount > 0 &&
+           st->bodies[st->bodyCount - 1].depth == st->depth &&
+           st->bodies[st->bodyCount - 1].parenDepth == st->parenDepth) {
+        popScope(st); // ';' ends the unbraced body
+        st->bodyCount--;
+    }
+    if (tok->type != TOKEN_KEYWORD && tok->type != TOKEN_RESERVEDWORD && tok->type != TOKEN_IDENTIFIER &&
+        tok->type != TOKEN_LINE_COMMENT && tok->type != TOKEN_BLOCK_COMMENT) {
+        st->declPending = 0;
+        st->declFixed = 0;
+    }
+    st->lastUse = use;
+}
+
+/* call once after the EOF token */
+void symbolsFinish(SymbolTable *st) {
+    if (!st->failed) flushHeldDeclaration(st);
+}
+
+
 /* ============================
    TOKEN NAME MAP
    ============================ */
@@ -918,58 +1267,34 @@ const char *tokenTypeName(TokenType t) {
     }
 }
 
-/* ============================
-   FILE IO + MAIN
-   ============================ */
-/* simple file reader */
-static char *readFile(const char *filename) {
-    FILE *f = fopen(filename, "rb");
-    if (!f) return NULL;
-    if (fseek(f, 0, SEEK_END) != 0) { fclose(f); return NULL; }
-    long size = ftell(f);
-    if (size < 0) size = 0;
-    rewind(f);
-    char *buf = (char*)malloc((size_t)size + 1);
-    if (!buf) { fclose(f); return NULL; }
-    size_t n = fread(buf, 1, (size_t)size, f);
-    buf[n] = '\0';
-    fclose(f);
-    return buf;
-}
-
-int main(int argc, char **argv) {
-    const char *input = (argc >= 2) ? argv[1] : "text.bsc";
-
-    /* Validate extension .bsc (basic check) */
-    size_t L = strlen(input);
-    if (L < 4 || strcasecmp(input + L - 4, ".bsc") != 0) {
-        fprintf(stderr, "Error: expected a .bsc file (got '%s')\n", input);
-        return 1;
-    }
-
-    char *source = readFile(input);
-    if (!source) {
-        fprintf(stderr, "Error: cannot open file '%s'\n", input);
-        return 1;
+/* Parse a comma-separated list of token names (as printed by tokenTypeName)
+   or the groups LITERAL, COMMENT, DELIMITER, OPERATOR. Returns 0 and names
+   the offending entry in *bad if something does not match. */
+int parseTokenMask(const char *list, TokenMask *mask, char *bad, size_t badSize) {
+    *mask = 0;
+    while (*list) {
+        const char *end = strchr(list, ',');
+        size_t len = end ? (size_t)(end - list) : strlen(list);
+        TokenMask bits = 0;
+
+        if (len == 7 && strncmp(list, "LITERAL", len) == 0) bits = TOKEN_RANGE(TOKEN_INT_LITERAL, TOKEN_CHAR_LITERAL);
+        else if (len == 7 && strncmp(list, "COMMENT", len) == 0) bits = TOKEN_RANGE(TOKEN_LINE_COMMENT, TOKEN_BLOCK_COMMENT);
+        else if (len == 9 && strncmp(list, "DELIMITER", len) == 0) bits = TOKEN_RANGE(TOKEN_LEFT_PARENTHESIS, TOKEN_RIGHT_CHAR_QUOTATION);
+        else if (len == 8 && strncmp(list, "OPERATOR", len) == 0) bits = TOKEN_RANGE(TOKEN_PLUS_OPERATOR, TOKEN_LOGICAL_OR_OPERATOR);
+        else {
+            for (int t = 0; t < TOKEN_TYPE_COUNT; t++) {
+                const char *name = tokenTypeName((TokenType)t);
+                if (strlen(name) == len && strncmp(list, name, len) == 0) { bits = TOKEN_BIT(t); break; }
+            }
+        }
+        if (!bits) {
+            snprintf(bad, badSize, "%.*s", (int)len, list);
+            return 0;
+        }
+        *mask |= bits;
+        list += len;
+        if (*list == ',') list++;
     }
+    return 1;
+}
 
-    Lexer lexer;
-    initLexer(&lexer, source);
-
-    FILE *out = fopen("symbol_table.txt", "w");
-    if (!out) { fprintf(stderr, "Error: cannot create symbol_table.txt\n"); free(source); return 1; }
-
-    Token tok;
-    do {
-        tok = getNextToken(&lexer);
-        const char *tname = tokenTypeName(tok.type);
-        const char *lex = tok.lexeme ? tok.lexeme : "";
-        printf("Lexeme: %-30s Token: %s\n", lex, tname);
-        fprintf(out, "Lexeme: %-30s Token: %s\n", lex, tname);
-        if (tok.lexeme) free(tok.lexeme);
-    } while (tok.type != TOKEN_EOF);
-
-    fclose(out);
-    free(source);
-    return 0;
-}
\ No newline at end of file
@@ -0,0 +1,388 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h>
+
+/* ============================
+   TOKEN DEFINITIONS
+   ============================ */
+typedef enum {
+    // End / Unknown
+    TOKEN_EOF,
+    TOKEN_UNKNOWN,
+
+    // Identifiers & words
+    TOKEN_IDENTIFIER,
+    TOKEN_KEYWORD,       // draft detection (you fill in isKeyword)
+    TOKEN_RESERVEDWORD,  // implemented below
+    TOKEN_NOISEWORD,     // implemented below
+
+    // Literals
+    TOKEN_INT_LITERAL,
+    TOKEN_FLOAT_LITERAL,
+    TOKEN_STRING_LITERAL,
+    TOKEN_CHAR_LITERAL,
+
+    // Comments
+    TOKEN_LINE_COMMENT,
+    TOKEN_BLOCK_COMMENT,
+
+    // Delimiters
+    TOKEN_LEFT_PARENTHESIS,
+    TOKEN_RIGHT_PARENTHESIS,
+    TOKEN_LEFT_BRACE,
+    TOKEN_RIGHT_BRACE,
+    TOKEN_LEFT_BRACKET,
+    TOKEN_RIGHT_BRACKET,
+    TOKEN_COMMA,
+    TOKEN_SEMICOLON,
+    TOKEN_COLON,
+    TOKEN_DOT,
+
+    // Quote delimiter tokens (explicit)
+    TOKEN_LEFT_STRING_QUOTATION,   // opening double-quote: "
+    TOKEN_RIGHT_STRING_QUOTATION,  // closing double-quote: "
+    TOKEN_LEFT_CHAR_QUOTATION,     // opening single-quote: '
+    TOKEN_RIGHT_CHAR_QUOTATION,    // closing single-quote: '
+
+    // Operators (explicit)
+    TOKEN_PLUS_OPERATOR,
+    TOKEN_MINUS_OPERATOR,
+    TOKEN_MULTIPLY_OPERATOR,
+    TOKEN_DIVIDE_OPERATOR,
+    TOKEN_MODULO_OPERATOR,
+    TOKEN_EXPONENT_OPERATOR,         // **
+    TOKEN_DIV_OPERATOR,              // $
+
+    TOKEN_ASSIGN_OPERATOR,           // =
+    TOKEN_EQUAL_OPERATOR,            // ==
+    TOKEN_LOGICAL_NOT_OPERATOR,      // !
+    TOKEN_NOT_EQUAL_OPERATOR,        // !=
+    TOKEN_LESS_THAN_OPERATOR,        // <
+    TOKEN_GREATER_THAN_OPERATOR,     // >
+    TOKEN_LESS_EQUAL_OPERATOR,       // <=
+    TOKEN_GREATER_EQUAL_OPERATOR,    // >=
+
+    TOKEN_INCREMENT_OPERATOR,        // ++
+    TOKEN_DECREMENT_OPERATOR,        // --
+    TOKEN_PLUS_ASSIGN_OPERATOR,      // +=
+    TOKEN_MINUS_ASSIGN_OPERATOR,     // -=
+    TOKEN_MULTIPLY_ASSIGN_OPERATOR,  // *=
+    TOKEN_DIVIDE_ASSIGN_OPERATOR,    // /=
+    TOKEN_MODULO_ASSIGN_OPERATOR,    // %=
+
+    TOKEN_LOGICAL_AND_OPERATOR,      // &&
+    TOKEN_LOGICAL_OR_OPERATOR,       // ||
+
+    TOKEN_TYPE_COUNT                 // number of token types (must stay <= 64)
+} TokenType;
+
+/* token type sets, used by setTokenFilter */
+typedef unsigned long long TokenMask;
+#define TOKEN_BIT(t)        (1ULL << (t))
+#define TOKEN_MASK_ALL      (~0ULL)
+#define TOKEN_RANGE(lo, hi) ((TOKEN_BIT((hi) + 1) - 1) & ~(TOKEN_BIT(lo) - 1))
+#define TOKEN_WORD_MASK     TOKEN_RANGE(TOKEN_IDENTIFIER, TOKEN_NOISEWORD)
+
+
+/* ============================
+   TOKEN STRUCT
+   ============================ */
+#define TOKEN_FLAG_UNTERMINATED  0x01  // literal or block comment has no closing delimiter
+#define TOKEN_FLAG_HAS_ESCAPES   0x02  // literal content contains at least one '\\'
+#define TOKEN_FLAG_TRUNCATED     0x04  // lexeme holds only the first maxLexeme chars
+
+typedef struct {
+    TokenType type;
+    char *lexeme; // null-terminated string (freeToken releases it); NULL for literals, see literalRaw
+    int start;    // source offset of the token (literals: the opening quote)
+    int length;   // chars covered in source (literals: both quotes included)
+    int flags;    // TOKEN_FLAG_* bits
+} Token;
+
+/* ============================
+   ALLOCATOR
+   ============================ */
+/* Where the library gets memory for lexemes, arena blocks and cache slots.
+   Every object carries its own allocator, so two lexers in one process can
+   use different pools; ctx is passed back untouched. */
+typedef struct {
+    void *(*alloc)(size_t size, void *ctx);
+    void (*release)(void *ptr, void *ctx);
+    void *ctx;
+} LexerAllocator;
+
+/* What an unclosed block comment or string literal covers. */
+typedef enum {
+    LEXER_RECOVER_TO_EOF,   // the rest of the file (default)
+    LEXER_RECOVER_AT_LINE   // up to the end of its line; lexing resumes on the next
+} LexerRecovery;
+
+/* ============================
+   LEXER STRUCT
+   ============================ */
+typedef struct {
+    const char *source;
+    int position;
+    char currentChar;
+    LexerAllocator allocator;      // owns every lexeme handed out (see freeToken)
+
+    /* query pushdown (see setTokenFilter) */
+    TokenMask want;                // token types getNextToken returns
+    int copyLexemes;               // 0: leave lexeme NULL, callers read the span
+
+    /* untrusted input (see setLexerLimits) */
+    int maxLexeme;                 // longest lexeme copy, 0 = unlimited
+    LexerRecovery recovery;
+    int noCommentClose;            // no "*/" at or after this offset (-1: not known yet)
+
+    /* legacy three-token quote output (see getNextLegacyToken) */
+    Token pending[2];              // queued CONTENT + RIGHT_QUOTATION tokens
+    int pendingHead;
+    int pendingCount;
+
+    struct BracketIndex *brackets; // delimiter matching, NULL when off (see trackBrackets)
+} Lexer;
+
+/* ============================
+   BRACKET INDEX
+   ============================ */
+typedef enum {
+    DELIM_UNCLOSED,     // opener with no closer before a mismatch or EOF
+    DELIM_STRAY         // closer with no opener of its kind still open
+} DelimiterIssueKind;
+
+typedef struct {
+    DelimiterIssueKind kind;
+    TokenType type;
+    int token;          // token index
+    int start;          // source offset
+} DelimiterIssue;
+
+typedef struct {
+    TokenType type;
+    int token;
+    int start;
+} OpenDelimiter;
+
+/* ( ) { } [ ] matched in the same pass that lexes them. Token indices count
+   the tokens the lexer returns (after filtering, legacy quote tokens
+   included), and partner[i] is the index of the delimiter matching token i,
+   -1 for every other token. A closer pairs with the innermost open
+   delimiter of its kind; openers above that one are reported unclosed. */
+typedef struct BracketIndex {
+    int *partner; int count, capacity;          // one entry per returned token
+    OpenDelimiter *open; int depth, openCap;    // innermost last
+    int openOfType[3];                          // open ( { [ on the stack
+    int maxDepth;
+    int pairs;
+    DelimiterIssue *issues; int issueCount, issueCap;
+    int failed;                                 // allocation failed: index stops growing
+    LexerAllocator allocator;
+} BracketIndex;
+
+/* ============================
+   ARENA / LITERAL CACHE
+   ============================ */
+/* Bump allocator: many small allocations, one free at the end. */
+typedef struct LexerArenaBlock {
+    struct LexerArenaBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} LexerArenaBlock;
+
+typedef struct {
+    LexerArenaBlock *head;
+    LexerAllocator allocator;
+} LexerArena;
+
+typedef struct {
+    int start;          // token start offset; -1 marks an empty slot
+    int length;         // decoded length (may contain '\0' bytes)
+    int valid;          // 0 if the literal holds a malformed escape
+    const char *text;   // decoded bytes in the cache arena
+} DecodedLiteral;
+
+/* Decoded escaped literals keyed by token offset, so each one is decoded at
+   most once no matter how many consumers ask for it. Offsets only mean
+   something within one source: the cache binds to the first source it
+   decodes from and starts over empty if it is handed another one. */
+typedef struct {
+    const char *source; // source the entries belong to (NULL: none yet)
+    LexerArena arena;
+    DecodedLiteral *slots;
+    int capacity;       // power of two
+    int count;
+} LiteralCache;
+
+/* ============================
+   NAME TABLE
+   ============================ */
+/* Open-addressing map from byte strings to dense ids 0, 1, 2, ... in the
+   order they were added. Keys are not copied: each must stay alive and
+   unchanged while the table holds it. */
+typedef struct {
+    const char *key;
+    int len;
+    unsigned hash;
+    int id;             // -1 marks an empty slot
+} LexerNameSlot;
+
+typedef struct {
+    LexerNameSlot *slots;
+    int capacity;       // power of two
+    int count;
+    LexerAllocator allocator;
+} LexerNameTable;
+
+/* ============================
+   SYMBOL TABLE
+   ============================ */
+typedef enum {
+    SYM_UNRESOLVED,     // identifier used with no visible declaration
+    SYM_SHADOWS,        // declaration hides one from an enclosing scope
+    SYM_REDECLARED,     // name declared twice in the same scope
+    SYM_FIXED_ASSIGN    // assignment to a fixed constant
+} SymbolIssueKind;
+
+typedef struct {
+    int nameId;
+    int declToken;      // token index of the declaring identifier (-1: builtin)
+    int line;
+    int depth;          // scope depth at declaration (0 = global)
+    int isFixed;
+    int isLoopVar;
+} SymbolDecl;
+
+typedef struct {
+    int token;          // token index of the use
+    int line;
+    int symbol;         // index into symbols
+} SymbolRef;
+
+typedef struct {
+    SymbolIssueKind kind;
+    int token;
+    int line;
+    int nameId;
+    int other;          // related symbol (shadowed/previous/fixed), or -1
+} SymbolIssue;
+
+typedef struct {
+    int nameId;
+    int previous;       // binding to restore when the scope closes
+} SymbolUndo;
+
+typedef struct {
+    int undoMark;
+    int closesLoop;     // popping this block also closes the cycle scope under it
+} SymbolScope;
+
+/* A cycle whose body is a single statement without braces keeps its loop
+   scope open until that statement ends: a ';', a new line or an enclosing
+   '}' at the nesting level the body started on. */
+typedef struct {
+    int depth;          // scope depth with the loop scope open
+    int parenDepth;
+    int line;           // line of the body's latest token
+} SymbolLoopBody;
+
+/* Declarations, resolved uses and scope issues, built in one pass over the
+   token stream (symbolsFeed per token). Names are interned into a
+   LexerNameTable that hands out stable name ids; binding[id] is the
+   innermost visible declaration. Declaring pushes the
+   old binding onto an undo log, so opening a scope is just remembering the
+   log length and closing it replays the log back to that mark - no
+   per-scope table copies. refs and issues are both in token order. */
+typedef struct {
+    const char *source;
+    LexerArena arena;                           // name copies
+    LexerNameTable nameTable;                   // keyed by the copies
+
+    const char **names; int nameCount, nameCap; // indexed by name id
+    int *binding; int bindingCap;
+
+    SymbolDecl *symbols; int symbolCount, symbolCap;
+    SymbolRef *refs; int refCount, refCap;
+    SymbolIssue *issues; int issueCount, issueCap;
+    SymbolUndo *undo; int undoCount, undoCap;
+    SymbolScope *scopes; int depth, scopeCap;
+
+    /* streaming state */
+    int line, lineOffset;       // line number at lineOffset (offsets only grow)
+    int declPending;            // saw a type word / fixed: next identifier is declared
+    int declFixed;
+    int heldToken;              // declared-name candidate waiting on one token of lookahead
+    int heldStart, heldLen;
+    int lastUse;                // symbol of the previous token if it was a resolved use
+    int loopState;              // 0 none, 1 in cycle header, 2 header closed, waiting for body
+    SymbolLoopBody *bodies; int bodyCount, bodyCap;   // open unbraced cycle bodies, innermost last
+    int loopParenDepth, parenDepth;
+
+    int failed;                                 // allocation failed: the table stops growing
+    LexerAllocator allocator;
+} SymbolTable;
+
+/* ============================
+   API
+   ============================ */
+/* The library keeps no global state: all of it lives in the Lexer,
+   LexerArena, LexerNameTable, LiteralCache, BracketIndex and SymbolTable
+   values the caller owns, so separate instances can run on separate
+   threads. source must stay alive
+   and unchanged while a lexer, cache or symbol table refers to it. */
+
+/* initLexer uses malloc/free; allocator may be NULL for the same */
+void initLexer(Lexer *lexer, const char *source);
+void initLexerWith(Lexer *lexer, const char *source, const LexerAllocator *allocator);
+void setTokenFilter(Lexer *lexer, TokenMask want, int copyLexemes);
+void setLexerLimits(Lexer *lexer, int maxLexeme, LexerRecovery recovery);
+
+Token getNextToken(Lexer *lexer);
+Token getNextLegacyToken(Lexer *lexer);
+void freeToken(Lexer *lexer, Token *token);
+
+/* allocator may be NULL for malloc/free; the index is complete once the
+   lexer has returned EOF */
+void initBracketIndex(BracketIndex *index, const LexerAllocator *allocator);
+void trackBrackets(Lexer *lexer, BracketIndex *index);
+void freeBracketIndex(BracketIndex *index);
+
+const char *tokenTypeName(TokenType t);
+int parseTokenMask(const char *list, TokenMask *mask, char *bad, size_t badSize);
+
+int isKeyword(const char *lexeme);
+int isReservedWord(const char *lexeme);
+int isNoiseWord(const char *lexeme);
+
+void initLexerArena(LexerArena *arena);
+void initLexerArenaWith(LexerArena *arena, const LexerAllocator *allocator);
+void *lexerArenaAlloc(LexerArena *arena, size_t size);
+void freeLexerArena(LexerArena *arena);
+
+/* allocator may be NULL for malloc/free. lexerNameIntern returns the id of
+   key, adding it as id count if it is new (-1: out of memory);
+   lexerNameFind returns -1 for a key that is not in the table. */
+void initLexerNameTable(LexerNameTable *table, const LexerAllocator *allocator);
+void freeLexerNameTable(LexerNameTable *table);
+unsigned lexerNameHash(const char *key, int len);
+int lexerNameIntern(LexerNameTable *table, const char *key, int len);
+int lexerNameFind(const LexerNameTable *table, const char *key, int len);
+
+const char *literalRaw(const char *source, const Token *token, int *len);
+void initLiteralCache(LiteralCache *cache);
+void initLiteralCacheWith(LiteralCache *cache, const LexerAllocator *allocator);
+void freeLiteralCache(LiteralCache *cache);
+int decodeLiteral(LiteralCache *cache, const char *source, const Token *token,
+                  const char **text, int *len);
+
+/* allocator may be NULL for malloc/free. Feed every token the lexer returns
+   (either token stream), numbering them from 0, then call symbolsFinish
+   once after the EOF token. */
+void initSymbolTable(SymbolTable *st, const char *source, const LexerAllocator *allocator);
+void symbolsFeed(SymbolTable *st, const Token *token, int index);
+void symbolsFinish(SymbolTable *st);
+void freeSymbolTable(SymbolTable *st);
+
+#endif /* LEXER_H */
@@ -0,0 +1,2226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+
+/* corpus tools (index build/lookup) need POSIX threads, dirent and mmap */
+#if !defined(_WIN32)
+#define LEXER_HAVE_POSIX 1
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#define LEXER_HAVE_INOTIFY 1    /* --watch */
+#include <sys/inotify.h>
+#endif
+#endif
+
+#include "lexer.h"
+
+/* append room for one more element, doubling from init */
+#define GROW(ptr, count, cap, init) \
+    do { if ((count) >= (cap)) { (cap) = (cap) ? (cap) * 2 : (init); \
+         (ptr) = realloc((ptr), sizeof(*(ptr)) * (cap)); } } while (0)
+
+/* ============================
+   TRACING
+   ============================ */
+/* Optional phase tracing, dumped as Chrome trace JSON (chrome://tracing,
+   Perfetto). Each thread appends begin/end events to its own fixed-size
+   buffer, so recording takes no locks; buffers are linked into a global
+   list with a CAS on first use. A full buffer drops new spans but always
+   keeps room to close the open ones, so the trace stays well nested.
+   When tracing is off every TRACE_* site is a single predictable branch.
+   Event names must be string literals. */
+#define TRACE_BUFFER_EVENTS (1 << 16)
+#define TRACE_BURST_WORDS   16      // shortest run of word tokens worth a span
+#define TRACE_WINDOW_BYTES  (64 * 1024)
+
+typedef struct {
+    const char *name;
+    uint64_t ns;
+    uint64_t dur;                   // 'X' (complete) events only
+    char phase;                     // 'B', 'E' or 'X'
+} TraceEvent;
+
+typedef struct TraceBuffer {
+    struct TraceBuffer *next;
+    int tid;
+    int count;
+    int open;                       // recorded 'B' events still waiting for their 'E'
+    int skipped;                    // dropped 'B' events still open (innermost)
+    long dropped;                   // events lost to a full buffer
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+static int traceEnabled = 0;
+static int traceWindowBytes = TRACE_WINDOW_BYTES;   // --trace-window
+static TraceBuffer *traceBuffers = NULL;
+static int traceNextTid = 1;
+static _Thread_local TraceBuffer *traceLocal = NULL;
+
+#define TRACE_BEGIN(name) do { if (traceEnabled) traceEvent((name), 'B'); } while (0)
+#define TRACE_END(name)   do { if (traceEnabled) traceEvent((name), 'E'); } while (0)
+
+static uint64_t traceNow(void) {
+    struct timespec ts;
+#ifdef LEXER_HAVE_POSIX
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static TraceBuffer *traceThreadBuffer(void) {
+    TraceBuffer *b = traceLocal;
+    if (!b) {
+        b = (TraceBuffer *)calloc(1, sizeof(TraceBuffer));
+        if (!b) return NULL;
+        b->tid = __atomic_fetch_add(&traceNextTid, 1, __ATOMIC_RELAXED);
+        b->next = __atomic_load_n(&traceBuffers, __ATOMIC_ACQUIRE);
+        while (!__atomic_compare_exchange_n(&traceBuffers, &b->next, b, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {}
+        traceLocal = b;
+    }
+    return b;
+}
+
+static void traceEvent(const char *name, char phase) {
+    TraceBuffer *b = traceThreadBuffer();
+    if (!b) return;
+    if (phase == 'E') {
+        if (b->skipped) { b->skipped--; b->dropped++; return; }
+        b->open--;
+    } else if (b->count + b->open + 1 >= TRACE_BUFFER_EVENTS) {
+        b->skipped++; // no room for this span and its end
+        b->dropped++;
+        return;
+    } else {
+        b->open++;
+    }
+    TraceEvent *e = &b->events[b->count++];
+    e->name = name;
+    e->phase = phase;
+    e->dur = 0;
+    e->ns = traceNow();
+}
+
+/* record a finished span that started at startNs (from traceNow) */
+static void traceSpan(const char *name, uint64_t startNs) {
+    TraceBuffer *b = traceThreadBuffer();
+    if (!b) return;
+    if (b->count + b->open + 1 >= TRACE_BUFFER_EVENTS) { b->dropped++; return; }
+    TraceEvent *e = &b->events[b->count++];
+    e->name = name;
+    e->phase = 'X';
+    e->ns = startNs;
+    e->dur = traceNow() - startNs;
+}
+
+/* Write every thread's events and free the buffers. Call after worker
+   threads have been joined. */
+static int traceWrite(const char *path) {
+    FILE *out = fopen(path, "w");
+    TraceBuffer *b = __atomic_exchange_n(&traceBuffers, NULL, __ATOMIC_ACQ_REL);
+    if (!out) return 0;
+
+    uint64_t origin = UINT64_MAX;
+    for (TraceBuffer *t = b; t; t = t->next) {
+        if (t->count && t->events[0].ns < origin) origin = t->events[0].ns;
+    }
+
+    fprintf(out, "{\"traceEvents\":[\n");
+    int first = 1;
+    long dropped = 0;
+    while (b) {
+        for (int i = 0; i < b->count; i++) {
+            const TraceEvent *e = &b->events[i];
+            fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+                    first ? "" : ",\n", e->name, e->phase, (double)(e->ns - origin) / 1000.0, b->tid);
+            if (e->phase == 'X') fprintf(out, ",\"dur\":%.3f", (double)e->dur / 1000.0);
+            fputc('}', out);
+            first = 0;
+        }
+        dropped += b->dropped;
+        TraceBuffer *next = b->next;
+        free(b);
+        b = next;
+    }
+    fprintf(out, "\n],\"otherData\":{\"droppedEvents\":%ld}}\n", dropped);
+    traceLocal = NULL;
+    return fclose(out) == 0;
+}
+
+/* Spans for a lexing loop: one "lex window" per traceWindowBytes of source,
+   with every run of TRACE_BURST_WORDS or more consecutive word tokens
+   nested as a "word-token run". A run span covers whole loop iterations
+   (lexing, classification and whatever the caller does per token), not
+   keyword lookup alone. */
+typedef struct {
+    int windowEnd;
+    int burstWords;
+    uint64_t burstStart;
+} LexTrace;
+
+static void lexTraceBegin(LexTrace *lt) {
+    lt->windowEnd = traceWindowBytes;
+    lt->burstWords = 0;
+    lt->burstStart = 0;
+    TRACE_BEGIN("lex window");
+}
+
+/* call once per token; position is the lexer offset after the token */
+static void lexTraceToken(LexTrace *lt, TokenType type, int position) {
+    if (!traceEnabled) return;
+    int isWord = (TOKEN_WORD_MASK & TOKEN_BIT(type)) != 0;
+    if (lt->burstWords && (!isWord || position >= lt->windowEnd)) {
+        if (lt->burstWords >= TRACE_BURST_WORDS) traceSpan("word-token run", lt->burstStart);
+        lt->burstWords = 0;
+    }
+    if (position >= lt->windowEnd) {
+        traceEvent("lex window", 'E');
+        traceEvent("lex window", 'B');
+        while (lt->windowEnd <= position) lt->windowEnd += traceWindowBytes;
+    }
+    if (isWord && lt->burstWords++ == 0) lt->burstStart = traceNow();
+}
+
+static void lexTraceEnd(LexTrace *lt) {
+    if (traceEnabled && lt->burstWords >= TRACE_BURST_WORDS) traceSpan("word-token run", lt->burstStart);
+    TRACE_END("lex window");
+}
+
+
+/* ============================
+   SYMBOL REPORT
+   ============================ */
+static void printSymbolReport(const SymbolTable *st, FILE *out) {
+    int declared = st->symbolCount - 1; // minus builtin show
+    fprintf(out, "\n=== SYMBOLS: %d declarations, %d references, %d issues ===\n",
+            declared, st->refCount, st->issueCount);
+    if (st->failed) fprintf(out, "(out of memory: table incomplete)\n");
+    /* both lists are recorded in token order: merge them so lines ascend */
+    int r = 0, i = 0;
+    while (r < st->refCount || i < st->issueCount) {
+        if (i >= st->issueCount || (r < st->refCount && st->refs[r].token < st->issues[i].token)) {
+            const SymbolRef *ref = &st->refs[r++];
+            const SymbolDecl *sym = &st->symbols[ref->symbol];
+            if (sym->declToken < 0) {
+                fprintf(out, "line %d: %-20s -> builtin\n", ref->line, st->names[sym->nameId]);
+            } else {
+                fprintf(out, "line %d: %-20s -> declared line %d%s%s\n", ref->line, st->names[sym->nameId], sym->line,
+                        sym->isFixed ? " (fixed)" : "", sym->isLoopVar ? " (cycle variable)" : "");
+            }
+            continue;
+        }
+        const SymbolIssue *is = &st->issues[i++];
+        const char *name = st->names[is->nameId];
+        switch (is->kind) {
+            case SYM_UNRESOLVED:
+                fprintf(out, "line %d: unresolved identifier '%s'\n", is->line, name); break;
+            case SYM_SHADOWS:
+                fprintf(out, "line %d: '%s' shadows declaration on line %d\n", is->line, name, st->symbols[is->other].line); break;
+            case SYM_REDECLARED:
+                fprintf(out, "line %d: '%s' already declared on line %d\n", is->line, name, st->symbols[is->other].line); break;
+            case SYM_FIXED_ASSIGN:
+                fprintf(out, "line %d: assignment to fixed '%s' (line %d)\n", is->line, name, st->symbols[is->other].line); break;
+        }
+    }
+}
+
+
+/* ============================
+   BRACKET REPORT
+   ============================ */
+static int compareIssueOffsets(const void *a, const void *b) {
+    const DelimiterIssue *x = (const DelimiterIssue *)a, *y = (const DelimiterIssue *)b;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+static void printBracketReport(const BracketIndex *bi, const char *source, FILE *out) {
+    fprintf(out, "\n=== BRACKETS: %d pairs, max depth %d, %d unbalanced ===\n",
+            bi->pairs, bi->maxDepth, bi->issueCount);
+    if (bi->failed) fprintf(out, "(out of memory: index incomplete)\n");
+    if (!bi->issueCount) return;
+
+    /* unclosed openers are reported at EOF; sort so lines come from one walk */
+    DelimiterIssue *issues = (DelimiterIssue *)malloc(sizeof(DelimiterIssue) * bi->issueCount);
+    if (!issues) return;
+    memcpy(issues, bi->issues, sizeof(DelimiterIssue) * bi->issueCount);
+    qsort(issues, bi->issueCount, sizeof(DelimiterIssue), compareIssueOffsets);
+    int line = 1, offset = 0;
+    for (int i = 0; i < bi->issueCount; i++) {
+        for (; offset < issues[i].start; offset++) if (source[offset] == '\n') line++;
+        fprintf(out, "line %d: %s '%c' (token %d)\n", line,
+                issues[i].kind == DELIM_UNCLOSED ? "unclosed" : "stray",
+                source[issues[i].start], issues[i].token);
+    }
+    free(issues);
+}
+
+/* ============================
+   TRANSPILER (basiCly -> C)
+   ============================ */
+/* Straight token-to-token translation into one C main():
+     check/otherwise -> if/else      cycle (a : b : c) -> for (a; b; c)
+     during -> while                 perform { } during (c) -> do { } while (c);
+     select/when/instead -> switch/case/default, stop/skip -> break/continue
+     tiny/short/digit/long/large -> int8_t/int16_t/int32_t/int64_t/int64_t
+     indiv -> char, text -> const char *, fixed -> const (fixed text -> const char *const)
+     $ -> /, a ** b -> bsc_pow(a, b); ** is right-associative: a ** b ** c is a ** (b ** c)
+     show(a, b) -> buffered prints of each argument plus a newline
+   Statements end at a newline (a ';' is inserted when the line ends in an
+   operand). User identifiers get a b_ prefix so they never collide with C.
+   A declaration whose initializer is a float literal becomes double. */
+typedef struct {
+    char *data;
+    size_t len, cap;
+} StrBuf;
+
+static void sbReserve(StrBuf *b, size_t extra) {
+    if (b->len + extra + 1 <= b->cap) return;
+    while (b->len + extra + 1 > b->cap) b->cap = b->cap ? b->cap * 2 : 4096;
+    b->data = (char *)realloc(b->data, b->cap);
+}
+
+static void sbAppendN(StrBuf *b, const char *s, size_t n) {
+    sbReserve(b, n);
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+}
+
+static void sbAppend(StrBuf *b, const char *s) {
+    sbAppendN(b, s, strlen(s));
+}
+
+static void sbInsert(StrBuf *b, size_t at, const char *s) {
+    size_t n = strlen(s);
+    sbReserve(b, n);
+    memmove(b->data + at + n, b->data + at, b->len - at + 1);
+    memcpy(b->data + at, s, n);
+    b->len += n;
+}
+
+/* append bytes as the body of a C string/char literal */
+static void sbAppendEscaped(StrBuf *b, const char *s, int len) {
+    char tmp[8];
+    for (int i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\'' || c == '\\') { tmp[0] = '\\'; tmp[1] = (char)c; sbAppendN(b, tmp, 2); }
+        else if (c < 32 || c >= 127) { snprintf(tmp, sizeof(tmp), "\\%03o", c); sbAppend(b, tmp); }
+        else sbAppendN(b, (const char *)&c, 1);
+    }
+}
+
+static const char *transpilePrelude =
+    "/* generated from basiCly */\n"
+    "#include <math.h>\n"
+    "#include <stdint.h>\n"
+    "#include <stdio.h>\n"
+    "#include <string.h>\n\n"
+    "static char bsc_out[1 << 16];\n"
+    "static size_t bsc_len;\n"
+    "static void bsc_flush(void) { fwrite(bsc_out, 1, bsc_len, stdout); bsc_len = 0; }\n"
+    "static void bsc_write(const char *s, size_t n) {\n"
+    "    if (bsc_len + n > sizeof(bsc_out)) bsc_flush();\n"
+    "    if (n > sizeof(bsc_out)) { fwrite(s, 1, n, stdout); return; }\n"
+    "    memcpy(bsc_out + bsc_len, s, n); bsc_len += n;\n"
+    "}\n"
+    "static void bsc_puts(const char *s) { bsc_write(s, strlen(s)); }\n"
+    "static void bsc_putc(char c) { bsc_write(&c, 1); }\n"
+    "static void bsc_putl(long long v) { char t[24]; bsc_write(t, (size_t)snprintf(t, sizeof t, \"%lld\", v)); }\n"
+    "static void bsc_putd(double v) { char t[32]; bsc_write(t, (size_t)snprintf(t, sizeof t, \"%g\", v)); }\n"
+    "static double bsc_pow(double a, double b) { return pow(a, b); }\n"
+    "#define BSC_PUT(x) _Generic((x), char *: bsc_puts, const char *: bsc_puts, char: bsc_putc, \\\n"
+    "    float: bsc_putd, double: bsc_putd, default: bsc_putl)(x)\n\n"
+    "int main(void) {\n";
+
+typedef struct {
+    int depth;          // paren depth the pending bsc_pow( waits to close at
+    size_t start;       // where its "bsc_pow(" was inserted
+} PowFrame;
+
+typedef enum { PAREN_PLAIN, PAREN_HEADER, PAREN_DO_TAIL, PAREN_FOR, PAREN_SHOW } ParenKind;
+
+typedef struct {
+    const char *source;
+    Token *toks;
+    int count;
+    LiteralCache literals;
+    StrBuf out;
+
+    ParenKind parens[256]; size_t parenAt[256]; int parenDepth;
+    int braceDo[256]; int braceDepth;   // 1 if the brace opened a perform body
+    PowFrame pows[64]; int powCount;
+    ParenKind nextParen;                // kind for the next '('
+    int doTail;                         // just closed a perform body
+    size_t operandStart;                // output offset of the last complete operand
+    size_t identAt;                     // output offset of the last identifier
+    int lastParenPlain;                 // last ')' closed an expression, not a header
+    int line, lineOffset;
+} Transpiler;
+
+static int tkIs(const Token *t, TokenType type, const char *text, const char *source) {
+    size_t n = strlen(text);
+    return t->type == type && (size_t)t->length == n && memcmp(source + t->start, text, n) == 0;
+}
+
+static int transpileLine(Transpiler *tp, int offset) {
+    while (tp->lineOffset < offset) {
+        if (tp->source[tp->lineOffset] == '\n') tp->line++;
+        tp->lineOffset++;
+    }
+    return tp->line;
+}
+
+/* token can end a statement: a ';' goes after it at a line break */
+static int endsOperand(const Transpiler *tp, int i) {
+    const Token *t = &tp->toks[i];
+    switch (t->type) {
+        case TOKEN_IDENTIFIER: case TOKEN_INT_LITERAL: case TOKEN_FLOAT_LITERAL:
+        case TOKEN_STRING_LITERAL: case TOKEN_CHAR_LITERAL:
+        case TOKEN_RIGHT_BRACKET: case TOKEN_INCREMENT_OPERATOR: case TOKEN_DECREMENT_OPERATOR:
+            return 1;
+        case TOKEN_KEYWORD:
+            return tkIs(t, TOKEN_KEYWORD, "stop", tp->source) || tkIs(t, TOKEN_KEYWORD, "skip", tp->source);
+        case TOKEN_RESERVEDWORD:
+            return tkIs(t, TOKEN_RESERVEDWORD, "true", tp->source) || tkIs(t, TOKEN_RESERVEDWORD, "false", tp->source);
+        default:
+            return 0;
+    }
+}
+
+static const char *widthType(const Transpiler *tp, const Token *t) {
+    const char *s = tp->source + t->start;
+    if (t->type != TOKEN_KEYWORD) return NULL;
+    if (t->length == 4 && memcmp(s, "tiny", 4) == 0) return "int8_t";
+    if (t->length == 5 && memcmp(s, "short", 5) == 0) return "int16_t";
+    if (t->length == 5 && memcmp(s, "digit", 5) == 0) return "int32_t";
+    if (t->length == 4 && memcmp(s, "long", 4) == 0) return "int64_t";
+    if (t->length == 5 && memcmp(s, "large", 5) == 0) return "int64_t";
+    if (t->length == 5 && memcmp(s, "indiv", 5) == 0) return "char";
+    return NULL;
+}
+
+/* a bsc_pow( waiting at this depth gets its ')' once an operand completes,
+   unless operand i is itself the base of another ** (right-associative) */
+static void closePows(Transpiler *tp, int i) {
+    if (i + 1 < tp->count && tp->toks[i + 1].type == TOKEN_EXPONENT_OPERATOR) return;
+    while (tp->powCount && tp->pows[tp->powCount - 1].depth == tp->parenDepth) {
+        tp->powCount--;
+        sbAppend(&tp->out, ")");
+        tp->operandStart = tp->pows[tp->powCount].start;
+    }
+}
+
+static int transpileError(Transpiler *tp, int i, const char *what) {
+    const Token *t = &tp->toks[i];
+    fprintf(stderr, "Error: line %d: %s '%.*s'\n", transpileLine(tp, t->start), what, t->length, tp->source + t->start);
+    return 0;
+}
+
+/* Emit token i (and any it consumes); returns the next index, or -1. */
+static int transpileToken(Transpiler *tp, int i) {
+    const Token *t = &tp->toks[i];
+    const char *src = tp->source + t->start;
+    StrBuf *out = &tp->out;
+    int complete = 0;   // token finished an operand
+    int doTail = tp->doTail;
+    tp->doTail = 0;
+
+    /* spacing: none inside brackets or before closers and separators */
+    char last = out->len ? out->data[out->len - 1] : ' ';
+    int tight = (last == '(' || last == '[' || last == ' ' || last == '\n') ||
+                t->type == TOKEN_RIGHT_PARENTHESIS || t->type == TOKEN_RIGHT_BRACKET ||
+                t->type == TOKEN_COMMA || t->type == TOKEN_DOT ||
+                ((t->type == TOKEN_INCREMENT_OPERATOR || t->type == TOKEN_DECREMENT_OPERATOR) && i > 0 && endsOperand(tp, i - 1)) ||
+                (t->type == TOKEN_LEFT_PARENTHESIS && i > 0 && tp->toks[i - 1].type == TOKEN_IDENTIFIER) ||
+                (t->type == TOKEN_LEFT_BRACKET && i > 0 && tp->toks[i - 1].type == TOKEN_IDENTIFIER);
+    if (!tight) sbAppend(out, " ");
+    size_t at = out->len;
+
+    switch (t->type) {
+        case TOKEN_KEYWORD: {
+            const char *type = widthType(tp, t);
+            if (type) {
+                /* width + digit ("long digit") is one type; float initializer -> double */
+                int j = i + 1;
+                while (j < tp->count && widthType(tp, &tp->toks[j])) j++;
+                if (j + 2 < tp->count && tp->toks[j].type == TOKEN_IDENTIFIER &&
+                    tkIs(&tp->toks[j + 1], TOKEN_ASSIGN_OPERATOR, "=", tp->source) &&
+                    tp->toks[j + 2].type == TOKEN_FLOAT_LITERAL && strcmp(type, "char") != 0) type = "double";
+                sbAppend(out, type);
+                return j;
+            }
+            if (tkIs(t, TOKEN_KEYWORD, "check", tp->source)) { sbAppend(out, "if"); tp->nextParen = PAREN_HEADER; }
+            else if (tkIs(t, TOKEN_KEYWORD, "otherwise", tp->source)) sbAppend(out, "else");
+            else if (tkIs(t, TOKEN_KEYWORD, "cycle", tp->source)) { sbAppend(out, "for"); tp->nextParen = PAREN_FOR; }
+            else if (tkIs(t, TOKEN_KEYWORD, "during", tp->source)) {
+                sbAppend(out, "while");
+                tp->nextParen = doTail ? PAREN_DO_TAIL : PAREN_HEADER;
+            }
+            else if (tkIs(t, TOKEN_KEYWORD, "perform", tp->source)) sbAppend(out, "do");
+            else if (tkIs(t, TOKEN_KEYWORD, "select", tp->source)) { sbAppend(out, "switch"); tp->nextParen = PAREN_HEADER; }
+            else if (tkIs(t, TOKEN_KEYWORD, "when", tp->source)) sbAppend(out, "case");
+            else if (tkIs(t, TOKEN_KEYWORD, "instead", tp->source)) sbAppend(out, "default");
+            else if (tkIs(t, TOKEN_KEYWORD, "stop", tp->source)) sbAppend(out, "break");
+            else if (tkIs(t, TOKEN_KEYWORD, "skip", tp->source)) sbAppend(out, "continue");
+            else return transpileError(tp, i, "unsupported keyword") ? 0 : -1;
+            break;
+        }
+        case TOKEN_RESERVEDWORD:
+            if (tkIs(t, TOKEN_RESERVEDWORD, "fixed", tp->source)) {
+                /* the variable is the constant, not the characters it points at */
+                if (i + 2 < tp->count && tkIs(&tp->toks[i + 1], TOKEN_IDENTIFIER, "text", tp->source) &&
+                    tp->toks[i + 2].type == TOKEN_IDENTIFIER) {
+                    sbAppend(out, "const char *const");
+                    return i + 2;
+                }
+                sbAppend(out, "const");
+            }
+            else if (tkIs(t, TOKEN_RESERVEDWORD, "true", tp->source)) { sbAppend(out, "1"); complete = 1; }
+            else if (tkIs(t, TOKEN_RESERVEDWORD, "false", tp->source)) { sbAppend(out, "0"); complete = 1; }
+            else return transpileError(tp, i, "unsupported reserved word") ? 0 : -1;
+            break;
+        case TOKEN_NOISEWORD:
+            out->len = tight ? at : at - 1; // noise words carry no meaning
+            out->data[out->len] = '\0';
+            return i + 1;
+        case TOKEN_IDENTIFIER:
+            if (t->length == 4 && memcmp(src, "show", 4) == 0 && i + 1 < tp->count &&
+                tp->toks[i + 1].type == TOKEN_LEFT_PARENTHESIS) {
+                if (i + 2 < tp->count && tp->toks[i + 2].type == TOKEN_RIGHT_PARENTHESIS) {
+                    sbAppend(out, "{ bsc_putc('\\n'); }");
+                    tp->lastParenPlain = 0;
+                    return i + 3;
+                }
+                sbAppend(out, "{ ");
+                tp->nextParen = PAREN_SHOW;
+                return i + 1;
+            }
+            if (t->length == 4 && memcmp(src, "text", 4) == 0 && i + 1 < tp->count &&
+                tp->toks[i + 1].type == TOKEN_IDENTIFIER) {
+                sbAppend(out, "const char *");
+                break;
+            }
+            tp->identAt = at;
+            sbAppend(out, "b_");
+            sbAppendN(out, src, (size_t)t->length);
+            /* a call's operand starts at its name and completes at its ')' */
+            complete = !(i + 1 < tp->count && tp->toks[i + 1].type == TOKEN_LEFT_PARENTHESIS);
+            break;
+        case TOKEN_INT_LITERAL:
+        case TOKEN_FLOAT_LITERAL:
+            sbAppendN(out, src, (size_t)t->length);
+            complete = 1;
+            break;
+        case TOKEN_STRING_LITERAL:
+        case TOKEN_CHAR_LITERAL: {
+            const char *value; int len;
+            if (t->flags & TOKEN_FLAG_UNTERMINATED) return transpileError(tp, i, "unterminated literal") ? 0 : -1;
+            if (!decodeLiteral(&tp->literals, tp->source, t, &value, &len)) return transpileError(tp, i, "invalid escape in") ? 0 : -1;
+            /* a C char constant is an int; the cast keeps show() printing a character */
+            char q = (t->type == TOKEN_STRING_LITERAL) ? '"' : '\'';
+            if (q == '\'') sbAppend(out, "((char)");
+            sbAppendN(out, &q, 1);
+            sbAppendEscaped(out, value, len);
+            sbAppendN(out, &q, 1);
+            if (q == '\'') sbAppend(out, ")");
+            complete = 1;
+            break;
+        }
+        case TOKEN_LINE_COMMENT:
+        case TOKEN_BLOCK_COMMENT:
+            out->len = tight ? at : at - 1;
+            out->data[out->len] = '\0';
+            return i + 1;
+        case TOKEN_LEFT_PARENTHESIS: {
+            if (tp->parenDepth == (int)(sizeof(tp->parens) / sizeof(tp->parens[0]))) return transpileError(tp, i, "nesting too deep at") ? 0 : -1;
+            ParenKind kind = tp->nextParen;
+            tp->nextParen = PAREN_PLAIN;
+            /* a call "name(" is one operand starting at the name */
+            size_t start = at;
+            if (i > 0 && tp->toks[i - 1].type == TOKEN_IDENTIFIER && kind == PAREN_PLAIN) start = tp->identAt;
+            tp->parens[tp->parenDepth] = kind;
+            tp->parenAt[tp->parenDepth] = start;
+            tp->parenDepth++;
+            sbAppend(out, kind == PAREN_SHOW ? "BSC_PUT(" : "(");
+            break;
+        }
+        case TOKEN_RIGHT_PARENTHESIS: {
+            if (tp->parenDepth == 0) return transpileError(tp, i, "unbalanced") ? 0 : -1;
+            tp->parenDepth--;
+            ParenKind kind = tp->parens[tp->parenDepth];
+            tp->lastParenPlain = (kind == PAREN_PLAIN);
+            if (kind == PAREN_SHOW) {
+                sbAppend(out, "); bsc_putc('\\n'); }");
+            } else {
+                sbAppend(out, ")");
+            }
+            if (kind == PAREN_DO_TAIL) sbAppend(out, ";");
+            if (kind == PAREN_PLAIN) {
+                tp->operandStart = tp->parenAt[tp->parenDepth];
+                complete = 1;
+                closePows(tp, i);
+                return i + 1;
+            }
+            break;
+        }
+        case TOKEN_COLON:
+            /* cycle header separators */
+            if (tp->parenDepth > 0 && tp->parens[tp->parenDepth - 1] == PAREN_FOR) sbAppend(out, ";");
+            else sbAppend(out, ":");
+            break;
+        case TOKEN_COMMA:
+            if (tp->parenDepth > 0 && tp->parens[tp->parenDepth - 1] == PAREN_SHOW) sbAppend(out, "); BSC_PUT(");
+            else sbAppend(out, ",");
+            break;
+        case TOKEN_LEFT_BRACE:
+            if (tp->braceDepth == (int)(sizeof(tp->braceDo) / sizeof(tp->braceDo[0]))) return transpileError(tp, i, "nesting too deep at") ? 0 : -1;
+            tp->braceDo[tp->braceDepth++] = (i > 0 && tkIs(&tp->toks[i - 1], TOKEN_KEYWORD, "perform", tp->source));
+            sbAppend(out, "{");
+            break;
+        case TOKEN_RIGHT_BRACE:
+            if (tp->braceDepth == 0) return transpileError(tp, i, "unbalanced") ? 0 : -1;
+            tp->doTail = tp->braceDo[--tp->braceDepth];
+            sbAppend(out, "}");
+            break;
+        case TOKEN_DIV_OPERATOR:
+            sbAppend(out, "/");
+            break;
+        case TOKEN_EXPONENT_OPERATOR:
+            if ((size_t)tp->powCount == sizeof(tp->pows) / sizeof(tp->pows[0])) return transpileError(tp, i, "too many chained") ? 0 : -1;
+            out->len = tight ? at : at - 1;
+            out->data[out->len] = '\0';
+            sbInsert(out, tp->operandStart, "bsc_pow(");
+            tp->pows[tp->powCount].depth = tp->parenDepth;
+            tp->pows[tp->powCount].start = tp->operandStart;
+            tp->powCount++;
+            sbAppend(out, ",");
+            return i + 1;
+        case TOKEN_UNKNOWN:
+            return transpileError(tp, i, "unexpected character") ? 0 : -1;
+        default:
+            sbAppendN(out, src, (size_t)t->length); // operators and the rest map 1:1
+            break;
+    }
+
+    if (complete) {
+        tp->operandStart = at;
+        closePows(tp, i);
+    }
+    return i + 1;
+}
+
+/* Translate a whole program; returns 1 and fills *out (malloc'd) on success. */
+static int transpileToC(const char *source, char **out) {
+    Transpiler tp;
+    memset(&tp, 0, sizeof(tp));
+    tp.source = source;
+    tp.line = 1;
+    initLiteralCache(&tp.literals);
+
+    Lexer lexer;
+    initLexer(&lexer, source);
+    setTokenFilter(&lexer, TOKEN_MASK_ALL, 0);
+    int cap = 0;
+    LexTrace lexTrace;
+    lexTraceBegin(&lexTrace);
+    for (;;) {
+        Token tok = getNextToken(&lexer);
+        lexTraceToken(&lexTrace, tok.type, lexer.position);
+        if (tok.type == TOKEN_EOF) break;
+        if (tok.type == TOKEN_LINE_COMMENT || tok.type == TOKEN_BLOCK_COMMENT) continue;
+        GROW(tp.toks, tp.count, cap, 256);
+        tp.toks[tp.count++] = tok;
+    }
+    lexTraceEnd(&lexTrace);
+    TRACE_BEGIN("emit C");
+
+    sbAppend(&tp.out, transpilePrelude);
+    sbAppend(&tp.out, "    ");
+    int ok = 1;
+    int i = 0;
+    while (i < tp.count) {
+        /* statement break: newline after an operand, outside any parens */
+        if (i > 0 && tp.parenDepth == 0) {
+            const Token *prev = &tp.toks[i - 1];
+            const Token *cur = &tp.toks[i];
+            int newline = memchr(source + prev->start + prev->length, '\n',
+                                 (size_t)(cur->start - prev->start - prev->length)) != NULL;
+            int closing = (cur->type == TOKEN_RIGHT_BRACE);
+            int opensBlock = (cur->type == TOKEN_LEFT_BRACE) || tkIs(cur, TOKEN_KEYWORD, "otherwise", source);
+            int endsStatement = endsOperand(&tp, i - 1) ||
+                                (prev->type == TOKEN_RIGHT_PARENTHESIS && tp.lastParenPlain);
+            if ((newline || closing) && !opensBlock && endsStatement) sbAppend(&tp.out, ";");
+            if (newline) {
+                sbAppend(&tp.out, "\n");
+                int indent = tp.braceDepth + 1 - closing;
+                for (int k = 0; k < indent; k++) sbAppend(&tp.out, "    ");
+            }
+        }
+        int next = transpileToken(&tp, i);
+        if (next <= 0) { ok = 0; break; }
+        i = next;
+    }
+    if (ok && tp.count && tp.parenDepth == 0 &&
+        (endsOperand(&tp, tp.count - 1) || (tp.toks[tp.count - 1].type == TOKEN_RIGHT_PARENTHESIS && tp.lastParenPlain))) {
+        sbAppend(&tp.out, ";");
+    }
+    if (ok && (tp.parenDepth || tp.braceDepth)) {
+        fprintf(stderr, "Error: unbalanced brackets at end of file\n");
+        ok = 0;
+    }
+    sbAppend(&tp.out, "\n    bsc_flush();\n    return 0;\n}\n");
+    TRACE_END("emit C");
+
+    free(tp.toks);
+    freeLiteralCache(&tp.literals);
+    if (!ok) { free(tp.out.data); return 0; }
+    *out = tp.out.data;
+    return 1;
+}
+
+
+#ifdef LEXER_HAVE_POSIX
+/* ============================
+   IDENTIFIER INDEX
+   ============================ */
+/* Persistent inverted index: identifier -> posting list of (file, offset)
+   over every .bsc file under a directory. On-disk layout, all offsets from
+   the start of the file:
+
+     IndexHeader
+     IndexFileRecord[fileCount]     sorted by path
+     IndexTermRecord[termCount]     sorted by name (binary searched)
+     strings                        paths and names, not terminated
+     postings                       per term: varint (file delta, offset delta)
+                                    pairs; the offset delta restarts at 0
+                                    whenever the file changes
+
+   Rebuilds reuse the postings of files whose mtime/size (or, failing that,
+   content hash) are unchanged, and only re-lex the rest - in parallel.
+   mtimes are kept in nanoseconds, and a file whose mtime is not older than
+   the previous index itself may have changed within one timestamp tick of
+   that build, so it is always re-hashed. */
+#define INDEX_MAGIC "BSCIDX1"
+
+static char *readFile(const char *filename);
+
+typedef struct {
+    char magic[8];
+    uint32_t fileCount;
+    uint32_t termCount;
+    uint64_t filesAt, termsAt, stringsAt, postingsAt;
+} IndexHeader;
+
+typedef struct {
+    uint32_t pathAt, pathLen;       // into strings
+    int64_t mtime;                  // nanoseconds
+    uint64_t size;
+    uint64_t hash;                  // FNV-1a of the contents
+} IndexFileRecord;
+
+typedef struct {
+    uint32_t nameAt, nameLen;       // into strings
+    uint64_t postingsAt;            // into postings
+    uint32_t postingBytes;
+    uint32_t count;
+} IndexTermRecord;
+
+typedef struct {
+    void *map;
+    size_t size;
+    int64_t mtime;                  // of the index file, nanoseconds
+    const IndexHeader *header;
+    const IndexFileRecord *files;
+    const IndexTermRecord *terms;
+    const char *strings;
+    const uint8_t *postings;
+} IndexView;
+
+typedef struct {
+    const char *name;               // per-file arena or the old index map
+    uint32_t len;
+    uint32_t offset;
+} Occurrence;
+
+typedef struct {
+    char *path;
+    int64_t mtime;
+    uint64_t size;
+    uint64_t hash;
+    int oldIndex;                   // record in the previous index, or -1
+    int reuse;                      // postings come from the previous index
+    int failed;
+    Occurrence *occ; int occCount, occCap;
+    LexerArena names;
+} IndexFile;
+
+typedef struct {
+    const char *name;
+    uint32_t len;
+    uint8_t *postings; uint32_t bytes, cap;
+    uint32_t count;
+    uint32_t lastFile, lastOffset;
+} IndexTerm;
+
+static uint64_t hashBytes(const char *s, size_t len) {
+    uint64_t h = 14695981039346656037ull; // FNV-1a 64
+    for (size_t i = 0; i < len; i++) { h ^= (unsigned char)s[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+static void putVarint(IndexTerm *t, uint32_t v) {
+    if (t->bytes + 5 > t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 16;
+        t->postings = (uint8_t *)realloc(t->postings, t->cap);
+    }
+    while (v >= 0x80) { t->postings[t->bytes++] = (uint8_t)(v | 0x80); v >>= 7; }
+    t->postings[t->bytes++] = (uint8_t)v;
+}
+
+/* decode one varint from [*p, end); 0 if it runs past end or overflows */
+static int getVarint(const uint8_t **p, const uint8_t *end, uint32_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*p >= end) return 0;
+        uint8_t b = *(*p)++;
+        *v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return 1;
+    }
+    return 0;
+}
+
+/* Walk one term's posting list: *file and *offset advance per entry.
+   Returns 0 on a truncated list or a file number outside the index. */
+static int nextPosting(const IndexView *view, const uint8_t **p, const uint8_t *end,
+                       uint32_t *file, uint32_t *offset) {
+    uint32_t df, dof;
+    if (!getVarint(p, end, &df) || !getVarint(p, end, &dof)) return 0;
+    if (df) { *file += df; *offset = 0; }
+    *offset += dof;
+    return *file < view->header->fileCount;
+}
+
+static int compareNames(const char *a, uint32_t alen, const char *b, uint32_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    if (c) return c;
+    return (alen > blen) - (alen < blen);
+}
+
+static int64_t mtimeNs(const struct stat *st) {
+#ifdef __APPLE__
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static void closeIndex(IndexView *view) {
+    if (view->map) munmap(view->map, view->size);
+    view->map = NULL;
+}
+
+static int openIndex(const char *path, IndexView *view) {
+    memset(view, 0, sizeof(*view));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IndexHeader)) { close(fd); return 0; }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    const IndexHeader *h = (const IndexHeader *)map;
+    size_t size = (size_t)st.st_size;
+    if (memcmp(h->magic, INDEX_MAGIC, 8) != 0 ||
+        h->filesAt + (uint64_t)h->fileCount * sizeof(IndexFileRecord) > size ||
+        h->termsAt + (uint64_t)h->termCount * sizeof(IndexTermRecord) > size ||
+        h->stringsAt > size || h->postingsAt > size || h->filesAt % 8 || h->termsAt % 8) {
+        munmap(map, size);
+        return 0;
+    }
+    view->map = map;
+    view->size = size;
+    view->mtime = mtimeNs(&st);
+    view->header = h;
+    view->files = (const IndexFileRecord *)((const char *)map + h->filesAt);
+    view->terms = (const IndexTermRecord *)((const char *)map + h->termsAt);
+    view->strings = (const char *)map + h->stringsAt;
+    view->postings = (const uint8_t *)map + h->postingsAt;
+
+    /* every record must stay inside the mapping; anything else is corrupt,
+       and a corrupt index is treated like a missing one. Posting bytes are
+       only decoded by the walks that need them (nextPosting bounds each). */
+    uint64_t stringBytes = size - h->stringsAt, postingBytes = size - h->postingsAt;
+    for (uint32_t i = 0; i < h->fileCount; i++) {
+        const IndexFileRecord *r = &view->files[i];
+        if ((uint64_t)r->pathAt + r->pathLen > stringBytes) { closeIndex(view); return 0; }
+    }
+    for (uint32_t i = 0; i < h->termCount; i++) {
+        const IndexTermRecord *t = &view->terms[i];
+        if ((uint64_t)t->nameAt + t->nameLen > stringBytes ||
+            t->postingsAt > postingBytes || t->postingBytes > postingBytes - t->postingsAt) {
+            closeIndex(view);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* old file record with this path, or -1 (records are sorted by path) */
+static int findIndexFile(const IndexView *view, const char *path) {
+    if (!view->map) return -1;
+    uint32_t len = (uint32_t)strlen(path);
+    int lo = 0, hi = (int)view->header->fileCount - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        const IndexFileRecord *r = &view->files[mid];
+        int c = compareNames(view->strings + r->pathAt, r->pathLen, path, len);
+        if (c == 0) return mid;
+        if (c < 0) lo = mid + 1; else hi = mid - 1;
+    }
+    return -1;
+}
+
+static int compareStrings(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int isBscName(const char *name) {
+    size_t len = strlen(name);
+    return len >= 4 && strcasecmp(name + len - 4, ".bsc") == 0;
+}
+
+/* Walk dir recursively, skipping dot entries. onDir (may be NULL) sees each
+   directory before its entries and can return 0 to skip it; onFile sees
+   every regular *.bsc file. Paths are only valid during the callback. */
+static void walkBscTree(const char *dir, int (*onDir)(const char *dir, void *ctx),
+                        void (*onFile)(const char *path, void *ctx), void *ctx) {
+    if (onDir && !onDir(dir, ctx)) return;
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (e->d_name[0] == '.') continue;
+        size_t n = strlen(dir) + strlen(e->d_name) + 2;
+        char *path = (char *)malloc(n);
+        snprintf(path, n, "%s/%s", dir, e->d_name);
+
+        struct stat st;
+        if (stat(path, &st) == 0) {
+            if (S_ISDIR(st.st_mode)) walkBscTree(path, onDir, onFile, ctx);
+            else if (S_ISREG(st.st_mode) && isBscName(e->d_name)) onFile(path, ctx);
+        }
+        free(path);
+    }
+    closedir(d);
+}
+
+typedef struct {
+    char **paths;
+    int count, cap;
+} PathList;
+
+static void addBscPath(const char *path, void *ctx) {
+    PathList *list = (PathList *)ctx;
+    GROW(list->paths, list->count, list->cap, 256);
+    list->paths[list->count++] = strdup(path);
+}
+
+/* recursively collect *.bsc paths under dir */
+static void collectBscFiles(const char *dir, char ***paths, int *count, int *cap) {
+    PathList list = { *paths, *count, *cap };
+    walkBscTree(dir, NULL, addBscPath, &list);
+    *paths = list.paths;
+    *count = list.count;
+    *cap = list.cap;
+}
+
+static void addOccurrence(IndexFile *f, const char *name, uint32_t len, uint32_t offset) {
+    GROW(f->occ, f->occCount, f->occCap, 64);
+    f->occ[f->occCount].name = name;
+    f->occ[f->occCount].len = len;
+    f->occ[f->occCount].offset = offset;
+    f->occCount++;
+}
+
+/* lex one changed file, keeping identifiers only (no lexeme copies) */
+static void lexIndexFile(IndexFile *f, const IndexView *old) {
+    char *source = readFile(f->path);
+    if (!source) { f->failed = 1; return; }
+    size_t len = strlen(source);
+    f->size = (uint64_t)len;
+    f->hash = hashBytes(source, len);
+    if (f->oldIndex >= 0 && old->files[f->oldIndex].hash == f->hash) {
+        f->reuse = 1; // touched but unchanged
+        free(source);
+        return;
+    }
+
+    TRACE_BEGIN("lex file");
+    Lexer lexer;
+    initLexer(&lexer, source);
+    setTokenFilter(&lexer, TOKEN_BIT(TOKEN_IDENTIFIER), 0);
+    for (Token tok = getNextToken(&lexer); tok.type != TOKEN_EOF; tok = getNextToken(&lexer)) {
+        char *name = (char *)lexerArenaAlloc(&f->names, (size_t)tok.length);
+        memcpy(name, source + tok.start, (size_t)tok.length);
+        addOccurrence(f, name, (uint32_t)tok.length, (uint32_t)tok.start);
+    }
+    TRACE_END("lex file");
+    free(source);
+}
+
+typedef struct {
+    IndexFile *files;
+    int count;
+    int next;                       // next file to claim (atomic)
+    const IndexView *old;
+} IndexJob;
+
+/* one worker per CPU (at most 64) on a shared job; runs inline if no
+   thread can be started */
+static void runWorkers(void *(*worker)(void *), void *job) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = ncpu > 1 ? (int)ncpu : 1;
+    if (nthreads > 64) nthreads = 64;
+    pthread_t threads[64];
+    int started = 0;
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_create(&threads[i], NULL, worker, job) != 0) break;
+        started++;
+    }
+    if (started == 0) worker(job);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+}
+
+static void *indexWorker(void *arg) {
+    IndexJob *job = (IndexJob *)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->count) break;
+        if (!job->files[i].reuse) lexIndexFile(&job->files[i], job->old);
+    }
+    return NULL;
+}
+
+/* hand the previous index's postings back to the files being reused;
+   0 if a posting list turns out to be corrupt */
+static int loadReusedPostings(const IndexView *old, IndexFile *files, int count) {
+    uint32_t oldCount = old->header->fileCount;
+    int *target = (int *)malloc(sizeof(int) * (oldCount ? oldCount : 1));
+    for (uint32_t i = 0; i < oldCount; i++) target[i] = -1;
+    int any = 0;
+    for (int i = 0; i < count; i++) {
+        if (files[i].reuse) { target[files[i].oldIndex] = i; any = 1; }
+    }
+    if (!any) { free(target); return 1; }
+
+    for (uint32_t t = 0; t < old->header->termCount; t++) {
+        const IndexTermRecord *term = &old->terms[t];
+        const char *name = old->strings + term->nameAt;
+        const uint8_t *p = old->postings + term->postingsAt, *end = p + term->postingBytes;
+        uint32_t file = 0, offset = 0;
+        for (uint32_t k = 0; k < term->count; k++) {
+            if (!nextPosting(old, &p, end, &file, &offset)) { free(target); return 0; }
+            if (target[file] >= 0) addOccurrence(&files[target[file]], name, term->nameLen, offset);
+        }
+    }
+    free(target);
+    return 1;
+}
+
+typedef struct {
+    IndexTerm *terms;
+    int count, cap;
+    LexerNameTable names;           // name -> terms index
+} TermTable;
+
+static IndexTerm *internTerm(TermTable *tt, const char *name, uint32_t len) {
+    int id = lexerNameIntern(&tt->names, name, (int)len);
+    if (id == tt->count) {
+        GROW(tt->terms, tt->count, tt->cap, 1024);
+        IndexTerm *t = &tt->terms[tt->count++];
+        memset(t, 0, sizeof(*t));
+        t->name = name;
+        t->len = len;
+    }
+    return &tt->terms[id];
+}
+
+static const IndexTerm *sortTerms; // qsort context for compareTermOrder
+
+static int compareTermOrder(const void *a, const void *b) {
+    const IndexTerm *x = &sortTerms[*(const int *)a];
+    const IndexTerm *y = &sortTerms[*(const int *)b];
+    return compareNames(x->name, x->len, y->name, y->len);
+}
+
+static int writeIndex(const char *indexPath, IndexFile *files, int fileCount, TermTable *tt) {
+    int *order = (int *)malloc(sizeof(int) * (tt->count ? tt->count : 1));
+    for (int i = 0; i < tt->count; i++) order[i] = i;
+    sortTerms = tt->terms;
+    qsort(order, (size_t)tt->count, sizeof(int), compareTermOrder);
+
+    IndexHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, INDEX_MAGIC, 8);
+    h.fileCount = (uint32_t)fileCount;
+    h.termCount = (uint32_t)tt->count;
+    h.filesAt = sizeof(IndexHeader);
+    h.termsAt = h.filesAt + sizeof(IndexFileRecord) * (uint64_t)fileCount;
+    h.stringsAt = h.termsAt + sizeof(IndexTermRecord) * (uint64_t)tt->count;
+    uint64_t stringBytes = 0;
+    for (int i = 0; i < fileCount; i++) stringBytes += strlen(files[i].path);
+    for (int i = 0; i < tt->count; i++) stringBytes += tt->terms[i].len;
+    h.postingsAt = h.stringsAt + stringBytes;
+
+    size_t n = strlen(indexPath) + 5;
+    char *tmp = (char *)malloc(n);
+    snprintf(tmp, n, "%s.tmp", indexPath);
+    FILE *out = fopen(tmp, "wb");
+    if (!out) { free(order); free(tmp); return 0; }
+
+    fwrite(&h, sizeof(h), 1, out);
+    uint32_t at = 0;
+    for (int i = 0; i < fileCount; i++) {
+        IndexFileRecord r;
+        r.pathAt = at; r.pathLen = (uint32_t)strlen(files[i].path);
+        r.mtime = files[i].mtime; r.size = files[i].size; r.hash = files[i].hash;
+        fwrite(&r, sizeof(r), 1, out);
+        at += r.pathLen;
+    }
+    uint64_t postingAt = 0;
+    for (int i = 0; i < tt->count; i++) {
+        const IndexTerm *t = &tt->terms[order[i]];
+        IndexTermRecord r;
+        r.nameAt = at; r.nameLen = t->len;
+        r.postingsAt = postingAt; r.postingBytes = t->bytes; r.count = t->count;
+        fwrite(&r, sizeof(r), 1, out);
+        at += t->len;
+        postingAt += t->bytes;
+    }
+    for (int i = 0; i < fileCount; i++) fwrite(files[i].path, 1, strlen(files[i].path), out);
+    for (int i = 0; i < tt->count; i++) fwrite(tt->terms[order[i]].name, 1, tt->terms[order[i]].len, out);
+    for (int i = 0; i < tt->count; i++) fwrite(tt->terms[order[i]].postings, 1, tt->terms[order[i]].bytes, out);
+
+    int ok = (ferror(out) == 0);
+    if (fclose(out) != 0) ok = 0;
+    if (ok && rename(tmp, indexPath) != 0) ok = 0;
+    if (!ok) remove(tmp);
+    free(tmp);
+    free(order);
+    return ok;
+}
+
+static int buildIndex(const char *dir, const char *indexPath) {
+    char **paths = NULL;
+    int count = 0, cap = 0;
+    collectBscFiles(dir, &paths, &count, &cap);
+    qsort(paths, (size_t)count, sizeof(char *), compareStrings);
+
+    IndexView old;
+    openIndex(indexPath, &old); // missing/corrupt index: full build
+
+    IndexFile *files = (IndexFile *)calloc((size_t)(count ? count : 1), sizeof(IndexFile));
+    for (int i = 0; i < count; i++) {
+        IndexFile *f = &files[i];
+        struct stat st;
+        f->path = paths[i];
+        initLexerArena(&f->names);
+        if (stat(f->path, &st) != 0) { f->failed = 1; continue; }
+        f->mtime = mtimeNs(&st);
+        f->size = (uint64_t)st.st_size;
+        f->oldIndex = findIndexFile(&old, f->path);
+        if (f->oldIndex >= 0) {
+            const IndexFileRecord *r = &old.files[f->oldIndex];
+            if (r->mtime == f->mtime && r->size == f->size && f->mtime < old.mtime) {
+                f->reuse = 1;
+                f->hash = r->hash;
+            }
+        }
+    }
+
+    IndexJob job = { files, count, 0, &old };
+    runWorkers(indexWorker, &job);
+
+    if (old.map && !loadReusedPostings(&old, files, count)) {
+        /* corrupt postings: nothing from the old index can be trusted */
+        for (int i = 0; i < count; i++) {
+            IndexFile *f = &files[i];
+            f->oldIndex = -1;
+            if (f->reuse) { f->occCount = 0; f->reuse = 0; }
+            else f->reuse = 1; // already lexed (or unreadable): skip this pass
+        }
+        job.next = 0;
+        runWorkers(indexWorker, &job);
+        for (int i = 0; i < count; i++) files[i].reuse = 0;
+    }
+
+    /* merge in file order so every posting list is sorted by (file, offset) */
+    TermTable tt;
+    memset(&tt, 0, sizeof(tt));
+    initLexerNameTable(&tt.names, NULL);
+    int relexed = 0, reused = 0, written = 0;
+    for (int i = 0; i < count; i++) {
+        IndexFile *f = &files[i];
+        if (f->failed) { fprintf(stderr, "Warning: cannot read '%s'\n", f->path); continue; }
+        if (f->reuse) reused++; else relexed++;
+        files[written] = *f;
+        for (int k = 0; k < f->occCount; k++) {
+            IndexTerm *t = internTerm(&tt, f->occ[k].name, f->occ[k].len);
+            uint32_t fileDelta = (uint32_t)written - t->lastFile;
+            if (fileDelta || t->count == 0) t->lastOffset = 0;
+            putVarint(t, fileDelta);
+            putVarint(t, f->occ[k].offset - t->lastOffset);
+            t->lastFile = (uint32_t)written;
+            t->lastOffset = f->occ[k].offset;
+            t->count++;
+        }
+        written++;
+    }
+
+    TRACE_BEGIN("write index");
+    int ok = writeIndex(indexPath, files, written, &tt);
+    TRACE_END("write index");
+    if (ok) {
+        printf("Indexed %d files (%d lexed, %d unchanged), %d identifiers -> %s\n",
+               written, relexed, reused, tt.count, indexPath);
+    } else {
+        fprintf(stderr, "Error: cannot write index '%s'\n", indexPath);
+    }
+
+    for (int i = 0; i < tt.count; i++) free(tt.terms[i].postings);
+    free(tt.terms);
+    freeLexerNameTable(&tt.names);
+    for (int i = 0; i < count; i++) {
+        free(paths[i]);
+        if (i < written) { free(files[i].occ); freeLexerArena(&files[i].names); }
+    }
+    free(paths);
+    free(files);
+    closeIndex(&old);
+    return ok;
+}
+
+/* print file:offset for every use of name; returns the number of hits */
+static long lookupIndex(const char *indexPath, const char *name, FILE *out) {
+    IndexView view;
+    if (!openIndex(indexPath, &view)) return -1;
+
+    long hits = 0;
+    uint32_t len = (uint32_t)strlen(name);
+    int lo = 0, hi = (int)view.header->termCount - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        const IndexTermRecord *t = &view.terms[mid];
+        int c = compareNames(view.strings + t->nameAt, t->nameLen, name, len);
+        if (c < 0) { lo = mid + 1; continue; }
+        if (c > 0) { hi = mid - 1; continue; }
+
+        const uint8_t *p = view.postings + t->postingsAt, *end = p + t->postingBytes;
+        uint32_t file = 0, offset = 0;
+        for (uint32_t k = 0; k < t->count && nextPosting(&view, &p, end, &file, &offset); k++) {
+            const IndexFileRecord *f = &view.files[file];
+            fprintf(out, "%.*s:%u\n", (int)f->pathLen, view.strings + f->pathAt, offset);
+        }
+        hits = t->count;
+        break;
+    }
+    closeIndex(&view);
+    return hits;
+}
+#endif /* LEXER_HAVE_POSIX */
+
+
+#ifdef LEXER_HAVE_POSIX
+/* ============================
+   CLONE DETECTION
+   ============================ */
+/* Token-level clones across every .bsc under a directory. Each file is
+   lexed (comments dropped) into normalized codes: identifiers all become
+   one code and literals their kind, so renaming variables or changing
+   constants does not hide a copy; keywords and operators keep their
+   identity. A Rabin-Karp hash is rolled over every window of `window`
+   codes, in parallel per file. The fingerprints are split by hash into
+   partitions that are sorted and joined in parallel; equal hashes from
+   different files are checked code by code, and adjacent matching windows
+   on the same diagonal are merged into one clone region. Only the first
+   copy of a window in each file takes part in the join, so repeats inside
+   one file neither count as boilerplate nor multiply the pairs; a window
+   found in more than maxBucket files is treated as shared boilerplate and
+   only counted. Each hash therefore costs at most maxBucket^2 pairs. */
+#define CLONE_BASE        1000003ull
+#define CLONE_PARTITIONS  256
+
+typedef struct {
+    char *path;
+    uint32_t *codes;    // normalized token per position
+    int *lines;         // source line per position
+    int count;
+    uint64_t *hashes;   // hashes[i]: window starting at token i
+    int windows;
+    int failed;
+} CloneFile;
+
+typedef struct {
+    uint64_t hash;
+    int file;
+    int pos;
+} Fingerprint;
+
+typedef struct {
+    int a, b;           // file indices, a < b
+    int posA, posB;     // window starts
+} CloneMatch;
+
+typedef struct {
+    CloneFile *files;
+    int count;
+    int next;           // next unclaimed file / partition (atomic)
+    int window;
+    int maxBucket;      // windows in more files are boilerplate, not reported
+    Fingerprint *prints;
+    size_t *partStart;  // CLONE_PARTITIONS + 1 bounds into prints
+    CloneMatch **matches; int *matchCount;   // per partition
+    long *boilerplate;                       // per partition: buckets skipped
+} CloneJob;
+
+static uint32_t cloneCode(const char *source, const Token *t) {
+    if (t->type == TOKEN_KEYWORD || t->type == TOKEN_RESERVEDWORD || t->type == TOKEN_NOISEWORD) {
+        return lexerNameHash(source + t->start, t->length) | 0x80000000u; // keeps the word itself
+    }
+    return (uint32_t)t->type; // identifiers and literals collapse to their type
+}
+
+static void scanCloneFile(CloneFile *f, int window) {
+    char *source = readFile(f->path);
+    if (!source) { f->failed = 1; return; }
+    TRACE_BEGIN("clone scan file");
+    Lexer lexer;
+    initLexer(&lexer, source);
+    setTokenFilter(&lexer, TOKEN_MASK_ALL & ~TOKEN_RANGE(TOKEN_LINE_COMMENT, TOKEN_BLOCK_COMMENT), 0);
+
+    int cap = 0, line = 1, lineOffset = 0;
+    for (Token tok = getNextToken(&lexer); tok.type != TOKEN_EOF; tok = getNextToken(&lexer)) {
+        if (f->count >= cap) {
+            cap = cap ? cap * 2 : 256;
+            f->codes = realloc(f->codes, sizeof(*f->codes) * cap);
+            f->lines = realloc(f->lines, sizeof(*f->lines) * cap);
+        }
+        for (; lineOffset < tok.start; lineOffset++) if (source[lineOffset] == '\n') line++;
+        f->codes[f->count] = cloneCode(source, &tok);
+        f->lines[f->count] = line;
+        f->count++;
+    }
+    free(source);
+
+    /* h(i) = sum codes[i + k] * B^(window - 1 - k), mod 2^64 */
+    f->windows = f->count >= window ? f->count - window + 1 : 0;
+    if (f->windows) {
+        f->hashes = (uint64_t *)malloc(sizeof(uint64_t) * f->windows);
+        uint64_t h = 0, top = 1;
+        for (int k = 0; k < window; k++) {
+            h = h * CLONE_BASE + f->codes[k];
+            if (k) top *= CLONE_BASE;
+        }
+        f->hashes[0] = h;
+        for (int i = 1; i < f->windows; i++) {
+            h = (h - f->codes[i - 1] * top) * CLONE_BASE + f->codes[i + window - 1];
+            f->hashes[i] = h;
+        }
+    }
+    TRACE_END("clone scan file");
+}
+
+static void *cloneScanWorker(void *arg) {
+    CloneJob *job = (CloneJob *)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->count) break;
+        scanCloneFile(&job->files[i], job->window);
+    }
+    return NULL;
+}
+
+static int compareFingerprints(const void *a, const void *b) {
+    const Fingerprint *x = (const Fingerprint *)a, *y = (const Fingerprint *)b;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    if (x->file != y->file) return x->file - y->file;
+    return x->pos - y->pos;
+}
+
+/* sort one partition and pair up equal hashes from different files */
+static void joinClonePartition(CloneJob *job, int part) {
+    Fingerprint *p = job->prints + job->partStart[part];
+    size_t n = job->partStart[part + 1] - job->partStart[part];
+    qsort(p, n, sizeof(Fingerprint), compareFingerprints);
+
+    CloneMatch *matches = NULL;
+    int count = 0, cap = 0;
+    size_t bytes = sizeof(uint32_t) * (size_t)job->window;
+    for (size_t lo = 0, hi; lo < n; lo = hi) {
+        for (hi = lo + 1; hi < n && p[hi].hash == p[lo].hash; hi++) {}
+        /* keep each file's earliest window (sorted by file, then position) */
+        size_t last = lo + 1;
+        for (size_t k = lo + 1; k < hi; k++) {
+            if (p[k].file != p[last - 1].file) p[last++] = p[k];
+        }
+        if (last - lo < 2) continue;                          // one file only
+        if (last - lo > (size_t)job->maxBucket) { job->boilerplate[part]++; continue; }
+        for (size_t i = lo; i < last; i++) {
+            for (size_t j = i + 1; j < last; j++) {
+                const CloneFile *fa = &job->files[p[i].file], *fb = &job->files[p[j].file];
+                if (memcmp(fa->codes + p[i].pos, fb->codes + p[j].pos, bytes) != 0) continue; // collision
+                GROW(matches, count, cap, 64);
+                matches[count].a = p[i].file;
+                matches[count].b = p[j].file;
+                matches[count].posA = p[i].pos;
+                matches[count].posB = p[j].pos;
+                count++;
+            }
+        }
+    }
+    job->matches[part] = matches;
+    job->matchCount[part] = count;
+}
+
+static void *cloneJoinWorker(void *arg) {
+    CloneJob *job = (CloneJob *)arg;
+    for (;;) {
+        int part = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (part >= CLONE_PARTITIONS) break;
+        joinClonePartition(job, part);
+    }
+    return NULL;
+}
+
+static int compareMatches(const void *x, const void *y) {
+    const CloneMatch *a = (const CloneMatch *)x, *b = (const CloneMatch *)y;
+    if (a->a != b->a) return a->a - b->a;
+    if (a->b != b->b) return a->b - b->b;
+    int da = a->posA - a->posB, db = b->posA - b->posB;
+    if (da != db) return da < db ? -1 : 1;
+    return a->posA - b->posA;
+}
+
+static int findClones(const char *dir, int window, int maxBucket) {
+    uint64_t t0 = traceNow();
+    char **paths = NULL;
+    int count = 0, cap = 0;
+    collectBscFiles(dir, &paths, &count, &cap);
+    if (count) qsort(paths, (size_t)count, sizeof(char *), compareStrings);
+
+    CloneJob job;
+    memset(&job, 0, sizeof(job));
+    job.files = (CloneFile *)calloc((size_t)(count ? count : 1), sizeof(CloneFile));
+    job.count = count;
+    job.window = window;
+    job.maxBucket = maxBucket;
+    for (int i = 0; i < count; i++) job.files[i].path = paths[i];
+
+    TRACE_BEGIN("clone scan");
+    runWorkers(cloneScanWorker, &job);
+    TRACE_END("clone scan");
+
+    /* bucket fingerprints by their top hash bits so partitions join independently */
+    TRACE_BEGIN("clone join");
+    size_t total = 0;
+    long tokens = 0;
+    size_t partCount[CLONE_PARTITIONS + 1] = {0};
+    for (int i = 0; i < count; i++) {
+        const CloneFile *f = &job.files[i];
+        tokens += f->count;
+        total += (size_t)f->windows;
+        for (int k = 0; k < f->windows; k++) partCount[f->hashes[k] >> 56]++;
+    }
+    size_t partStart[CLONE_PARTITIONS + 1];
+    partStart[0] = 0;
+    for (int p = 0; p < CLONE_PARTITIONS; p++) partStart[p + 1] = partStart[p] + partCount[p];
+    job.prints = (Fingerprint *)malloc(sizeof(Fingerprint) * (total ? total : 1));
+    for (int p = 0; p < CLONE_PARTITIONS; p++) partCount[p] = partStart[p];
+    for (int i = 0; i < count; i++) {
+        const CloneFile *f = &job.files[i];
+        for (int k = 0; k < f->windows; k++) {
+            Fingerprint *fp = &job.prints[partCount[f->hashes[k] >> 56]++];
+            fp->hash = f->hashes[k];
+            fp->file = i;
+            fp->pos = k;
+        }
+    }
+
+    CloneMatch *matchLists[CLONE_PARTITIONS];
+    int matchCounts[CLONE_PARTITIONS];
+    long boilerplate[CLONE_PARTITIONS] = {0};
+    job.partStart = partStart;
+    job.matches = matchLists;
+    job.matchCount = matchCounts;
+    job.boilerplate = boilerplate;
+    job.next = 0;
+    runWorkers(cloneJoinWorker, &job);
+
+    int matchTotal = 0;
+    long skipped = 0;
+    for (int p = 0; p < CLONE_PARTITIONS; p++) { matchTotal += matchCounts[p]; skipped += boilerplate[p]; }
+    CloneMatch *matches = (CloneMatch *)malloc(sizeof(CloneMatch) * (matchTotal ? matchTotal : 1));
+    matchTotal = 0;
+    for (int p = 0; p < CLONE_PARTITIONS; p++) {
+        if (matchCounts[p]) memcpy(matches + matchTotal, matchLists[p], sizeof(CloneMatch) * matchCounts[p]);
+        matchTotal += matchCounts[p];
+        free(matchLists[p]);
+    }
+    qsort(matches, (size_t)matchTotal, sizeof(CloneMatch), compareMatches);
+    TRACE_END("clone join");
+
+    /* consecutive windows on one diagonal form a single region */
+    int regions = 0, pairs = 0;
+    for (int i = 0, j; i < matchTotal; i = j) {
+        const CloneMatch *m = &matches[i];
+        for (j = i + 1; j < matchTotal && matches[j].a == m->a && matches[j].b == m->b &&
+             matches[j].posA - matches[j].posB == m->posA - m->posB &&
+             matches[j].posA == matches[j - 1].posA + 1; j++) {}
+        if (i == 0 || matches[i - 1].a != m->a || matches[i - 1].b != m->b) pairs++;
+        int len = (j - i) + window - 1;
+        const CloneFile *fa = &job.files[m->a], *fb = &job.files[m->b];
+        printf("%s:%d-%d ~ %s:%d-%d (%d tokens)\n",
+               fa->path, fa->lines[m->posA], fa->lines[m->posA + len - 1],
+               fb->path, fb->lines[m->posB], fb->lines[m->posB + len - 1], len);
+        regions++;
+    }
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        CloneFile *f = &job.files[i];
+        if (f->failed) { fprintf(stderr, "Warning: cannot read '%s'\n", f->path); failed++; }
+        free(f->codes); free(f->lines); free(f->hashes); free(f->path);
+    }
+    printf("Scanned %d files, %ld tokens in %.1f ms: %d clone regions across %d file pairs",
+           count - failed, tokens, (double)(traceNow() - t0) / 1e6, regions, pairs);
+    if (skipped) printf(" (%ld boilerplate windows skipped)", skipped);
+    printf("\n");
+
+    free(matches);
+    free(job.prints);
+    free(job.files);
+    free(paths);
+    return 1;
+}
+#endif /* LEXER_HAVE_POSIX */
+
+
+#ifdef LEXER_HAVE_INOTIFY
+/* ============================
+   WATCH MODE
+   ============================ */
+/* Long-running re-lexer for a directory of .bsc files. Every file's
+   source, token spans and per-type counts stay in memory; an inotify event
+   re-reads the file and only re-lexes (and rewrites <file>.tok) when its
+   content hash changed. Outputs are written to a temp file and renamed, so
+   readers never see a half-written dump. */
+typedef struct {
+    char *path;
+    int alive;
+    uint64_t hash;
+    char *source;
+    Token *tokens; int tokenCount, tokenCap;   // compact tokens, spans only
+    long counts[TOKEN_TYPE_COUNT];
+} WatchedFile;
+
+typedef struct {
+    WatchedFile *files; int count, cap;
+    LexerNameTable paths;                        // path -> files index
+    char **dirs; int *wds; int dirCount, dirCap; // inotify watch descriptors
+    int fd;
+} Watcher;
+
+static WatchedFile *watchedFile(Watcher *w, const char *path, int create) {
+    int len = (int)strlen(path);
+    int id = lexerNameFind(&w->paths, path, len);
+    if (id >= 0) return &w->files[id];
+    if (!create) return NULL;
+
+    GROW(w->files, w->count, w->cap, 64);
+    WatchedFile *f = &w->files[w->count];
+    memset(f, 0, sizeof(*f));
+    f->path = strdup(path);
+    lexerNameIntern(&w->paths, f->path, len); // id == w->count
+    w->count++;
+    return f;
+}
+
+static void dropWatchedContent(WatchedFile *f) {
+    free(f->source);
+    free(f->tokens);
+    f->source = NULL;
+    f->tokens = NULL;
+    f->tokenCount = f->tokenCap = 0;
+}
+
+static int writeWatchDump(const WatchedFile *f) {
+    size_t n = strlen(f->path) + 9;
+    char *dst = (char *)malloc(n), *tmp = (char *)malloc(n);
+    snprintf(dst, n, "%s.tok", f->path);
+    snprintf(tmp, n, "%s.tok~", f->path);
+    FILE *out = fopen(tmp, "w");
+    int ok = out != NULL;
+    if (out) {
+        TRACE_BEGIN("flush output");
+        for (int i = 0; i < f->tokenCount; i++) {
+            const Token *t = &f->tokens[i];
+            const char *lex = f->source + t->start;
+            int len = t->length;
+            if (t->type == TOKEN_STRING_LITERAL || t->type == TOKEN_CHAR_LITERAL) lex = literalRaw(f->source, t, &len);
+            fprintf(out, "Lexeme: %-30.*s Token: %s%s\n", len, lex, tokenTypeName(t->type),
+                    (t->flags & TOKEN_FLAG_UNTERMINATED) ? " (unterminated)" : "");
+        }
+        fprintf(out, "Lexeme: %-30s Token: %s\n", "EOF", tokenTypeName(TOKEN_EOF));
+        TRACE_END("flush output");
+        if (ferror(out)) ok = 0;
+        if (fclose(out) != 0) ok = 0;
+        if (ok && rename(tmp, dst) != 0) ok = 0;
+        if (!ok) remove(tmp);
+    }
+    free(dst);
+    free(tmp);
+    return ok;
+}
+
+/* (re)load one file; returns 1 if it was re-lexed */
+static int refreshWatchedFile(Watcher *w, const char *path) {
+    char *source = readFile(path);
+    if (!source) return 0;
+    uint64_t hash = hashBytes(source, strlen(source));
+    WatchedFile *f = watchedFile(w, path, 1);
+    if (f->alive && f->source && f->hash == hash) { free(source); return 0; }
+
+    uint64_t t0 = traceNow();
+    dropWatchedContent(f);
+    f->alive = 1;
+    f->hash = hash;
+    f->source = source;
+    memset(f->counts, 0, sizeof(f->counts));
+
+    TRACE_BEGIN("lex file");
+    Lexer lexer;
+    initLexer(&lexer, source);
+    setTokenFilter(&lexer, TOKEN_MASK_ALL, 0);
+    for (Token tok = getNextToken(&lexer); tok.type != TOKEN_EOF; tok = getNextToken(&lexer)) {
+        GROW(f->tokens, f->tokenCount, f->tokenCap, 256);
+        f->tokens[f->tokenCount++] = tok;
+        f->counts[tok.type]++;
+    }
+    TRACE_END("lex file");
+
+    if (!writeWatchDump(f)) fprintf(stderr, "Error: cannot write '%s.tok'\n", path);
+    printf("lexed %s: %d tokens, %ld identifiers (%.3f ms)\n", path, f->tokenCount,
+           f->counts[TOKEN_IDENTIFIER], (double)(traceNow() - t0) / 1e6);
+    fflush(stdout);
+    return 1;
+}
+
+static void forgetWatchedFile(Watcher *w, const char *path) {
+    WatchedFile *f = watchedFile(w, path, 0);
+    if (!f || !f->alive) return;
+    f->alive = 0;
+    dropWatchedContent(f);
+    size_t n = strlen(path) + 5;
+    char *dst = (char *)malloc(n);
+    snprintf(dst, n, "%s.tok", path);
+    remove(dst);
+    free(dst);
+    printf("removed %s\n", path);
+    fflush(stdout);
+}
+
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE)
+
+static int watchDir(const char *dir, void *ctx) {
+    Watcher *w = (Watcher *)ctx;
+    int wd = inotify_add_watch(w->fd, dir, WATCH_MASK);
+    if (wd < 0) { fprintf(stderr, "Warning: cannot watch '%s'\n", dir); return 0; }
+    GROW(w->dirs, w->dirCount, w->dirCap, 16);
+    w->wds = (int *)realloc(w->wds, sizeof(int) * w->dirCap);
+    w->dirs[w->dirCount] = strdup(dir);
+    w->wds[w->dirCount] = wd;
+    w->dirCount++;
+    return 1;
+}
+
+static void watchFile(const char *path, void *ctx) {
+    refreshWatchedFile((Watcher *)ctx, path);
+}
+
+/* watch dir and everything below it, lexing the .bsc files found there */
+static void watchTree(Watcher *w, const char *dir) {
+    walkBscTree(dir, watchDir, watchFile, w);
+}
+
+static const char *watchedDir(const Watcher *w, int wd) {
+    for (int i = w->dirCount - 1; i >= 0; i--) {
+        if (w->wds[i] == wd) return w->dirs[i];
+    }
+    return NULL;
+}
+
+/* Runs until killed (or the watch descriptor fails). */
+static int runWatch(const char *dir) {
+    Watcher w;
+    memset(&w, 0, sizeof(w));
+    initLexerNameTable(&w.paths, NULL);
+    w.fd = inotify_init1(IN_CLOEXEC);
+    if (w.fd < 0) { fprintf(stderr, "Error: inotify unavailable\n"); return 0; }
+
+    watchTree(&w, dir);
+    printf("watching %s (%d files)\n", dir, w.count);
+    fflush(stdout);
+
+    char buf[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t n = read(w.fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            const char *parent = watchedDir(&w, ev->wd);
+            if (!parent || !ev->len) continue;
+
+            size_t len = strlen(parent) + strlen(ev->name) + 2;
+            char *path = (char *)malloc(len);
+            snprintf(path, len, "%s/%s", parent, ev->name);
+
+            if (ev->mask & IN_ISDIR) {
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) watchTree(&w, path);
+            } else if (isBscName(ev->name)) {
+                if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) refreshWatchedFile(&w, path);
+                else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) forgetWatchedFile(&w, path);
+            }
+            free(path);
+        }
+    }
+    close(w.fd);
+    return 1;
+}
+#endif /* LEXER_HAVE_INOTIFY */
+
+
+
+/* ============================
+   STRESS SUITE
+   ============================ */
+/* --stress: lex generated worst-case inputs at doubling sizes, under both
+   recovery modes, and check that time per byte stays flat and that live
+   lexeme memory never exceeds a few maxLexeme-sized copies. Fails (exit 1)
+   when a case grows faster than linearly or its memory tracks input size. */
+#define STRESS_MAX_LEXEME 4096
+#define STRESS_MIN_BYTES  (256 * 1024)
+#define STRESS_RUNS       3        // best of, to keep timer noise out
+#define STRESS_SLOWDOWN   3.0      // allowed ns/byte growth, smallest to largest size
+
+typedef struct {
+    size_t live;
+    size_t peak;
+} StressMeter;
+
+/* 16-byte header keeps the block size for release and the payload aligned */
+static void *stressAlloc(size_t size, void *ctx) {
+    StressMeter *m = (StressMeter *)ctx;
+    char *p = (char *)malloc(size + 16);
+    if (!p) return NULL;
+    *(size_t *)p = size;
+    m->live += size;
+    if (m->live > m->peak) m->peak = m->live;
+    return p + 16;
+}
+
+static void stressRelease(void *ptr, void *ctx) {
+    StressMeter *m = (StressMeter *)ctx;
+    char *p = (char *)ptr - 16;
+    m->live -= *(size_t *)p;
+    free(p);
+}
+
+typedef struct {
+    const char *name;
+    const char *prefix;     // written once
+    const char *unit;       // repeated to fill the input
+} StressCase;
+
+static const StressCase stressCases[] = {
+    { "unclosed /*",      "/*", "comment text that never ends\n" },
+    { "unclosed \"",      "\"", "string text that never ends\n" },
+    { "huge identifier",  "",   "a" },
+    { "run of *",         "",   "*" },
+    { "run of \\",        "",   "\\" },
+    { "/* on every line", "",   "/*\n" },
+    { "\" on every line", "",   "\"\n" },
+    { "escapes in \"",    "\"", "\\\"" },
+};
+
+static char *stressInput(const StressCase *c, size_t size) {
+    char *buf = (char *)malloc(size + 1);
+    if (!buf) return NULL;
+    size_t used = strlen(c->prefix), unitLen = strlen(c->unit);
+    memcpy(buf, c->prefix, used);
+    while (used < size) {
+        size_t n = size - used < unitLen ? size - used : unitLen;
+        memcpy(buf + used, c->unit, n);
+        used += n;
+    }
+    buf[size] = '\0';
+    return buf;
+}
+
+/* lex source the way the default dump does; returns elapsed ns */
+static uint64_t stressLex(const char *source, LexerRecovery recovery, StressMeter *meter, long *tokens) {
+    LexerAllocator allocator = { stressAlloc, stressRelease, meter };
+    Lexer lexer;
+    initLexerWith(&lexer, source, &allocator);
+    setLexerLimits(&lexer, STRESS_MAX_LEXEME, recovery);
+
+    uint64_t t0 = traceNow();
+    Token tok;
+    *tokens = 0;
+    do {
+        tok = getNextLegacyToken(&lexer);
+        (*tokens)++;
+        freeToken(&lexer, &tok);
+    } while (tok.type != TOKEN_EOF);
+    return traceNow() - t0;
+}
+
+static int runStress(int maxMb) {
+    size_t maxBytes = (size_t)maxMb * 1024 * 1024;
+    size_t memLimit = 4 * (STRESS_MAX_LEXEME + 64);   // pending quote tokens + current lexeme
+    int failures = 0;
+
+    printf("%-18s %-8s %10s %10s %9s %8s %10s\n", "case", "recovery", "bytes", "tokens", "ms", "ns/byte", "peak mem");
+    for (size_t ci = 0; ci < sizeof(stressCases) / sizeof(stressCases[0]); ci++) {
+        for (int r = 0; r < 2; r++) {
+            LexerRecovery recovery = r ? LEXER_RECOVER_AT_LINE : LEXER_RECOVER_TO_EOF;
+            double firstRate = 0, rate = 0;
+            size_t peak = 0;
+            for (size_t size = STRESS_MIN_BYTES; size <= maxBytes; size *= 2) {
+                char *source = stressInput(&stressCases[ci], size);
+                if (!source) { fprintf(stderr, "Error: out of memory\n"); return 0; }
+                StressMeter meter = {0, 0};
+                uint64_t best = UINT64_MAX;
+                long tokens = 0;
+                for (int run = 0; run < STRESS_RUNS; run++) {
+                    uint64_t ns = stressLex(source, recovery, &meter, &tokens);
+                    if (ns < best) best = ns;
+                }
+                free(source);
+                rate = (double)best / (double)size;
+                if (size == STRESS_MIN_BYTES) firstRate = rate;
+                if (meter.peak > peak) peak = meter.peak;
+                printf("%-18s %-8s %10zu %10ld %9.2f %8.2f %10zu\n", stressCases[ci].name,
+                       r ? "line" : "eof", size, tokens, (double)best / 1e6, rate, meter.peak);
+            }
+            if (firstRate > 0 && rate > firstRate * STRESS_SLOWDOWN) {
+                printf("FAIL %s (%s): %.1fx slower per byte at the largest size\n",
+                       stressCases[ci].name, r ? "line" : "eof", rate / firstRate);
+                failures++;
+            }
+            if (peak > memLimit) {
+                printf("FAIL %s (%s): %zu bytes live, limit %zu\n",
+                       stressCases[ci].name, r ? "line" : "eof", peak, memLimit);
+                failures++;
+            }
+        }
+    }
+    printf("%s: %d failure%s\n", failures ? "FAIL" : "ok", failures, failures == 1 ? "" : "s");
+    return failures == 0;
+}
+
+/* ============================
+   FILE IO + MAIN
+   ============================ */
+/* simple file reader */
+static char *readFile(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return NULL;
+    TRACE_BEGIN("readFile");
+    char *buf = NULL;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        long size = ftell(f);
+        if (size < 0) size = 0;
+        rewind(f);
+        buf = (char*)malloc((size_t)size + 1);
+        if (buf) {
+            size_t n = fread(buf, 1, (size_t)size, f);
+            buf[n] = '\0';
+        }
+    }
+    fclose(f);
+    TRACE_END("readFile");
+    return buf;
+}
+
+/* Dump output: lines are formatted once into a buffer that is written to
+   stdout and symbol_table.txt together, so each flush shows up as one
+   trace event instead of hiding inside stdio. */
+typedef struct {
+    char buf[1 << 16];
+    size_t used;
+    FILE *console;
+    FILE *file;
+} DumpSink;
+
+static void sinkFlush(DumpSink *sink) {
+    if (!sink->used) return;
+    TRACE_BEGIN("flush output");
+    fwrite(sink->buf, 1, sink->used, sink->console);
+    fwrite(sink->buf, 1, sink->used, sink->file);
+    sink->used = 0;
+    TRACE_END("flush output");
+}
+
+static void sinkLine(DumpSink *sink, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    size_t room = sizeof(sink->buf) - sink->used;
+    int n = vsnprintf(sink->buf + sink->used, room, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n < room) { sink->used += (size_t)n; return; }
+
+    /* did not fit: flush, then retry or, for huge lexemes, write through */
+    sinkFlush(sink);
+    va_start(ap, fmt);
+    n = vsnprintf(sink->buf, sizeof(sink->buf), fmt, ap);
+    va_end(ap);
+    if (n >= 0 && (size_t)n < sizeof(sink->buf)) { sink->used = (size_t)n; return; }
+    va_start(ap, fmt);
+    vfprintf(sink->console, fmt, ap);
+    va_end(ap);
+    va_start(ap, fmt);
+    vfprintf(sink->file, fmt, ap);
+    va_end(ap);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--compact] [--symbols] [--brackets] [--only=TYPES] [--count] <file.bsc>\n", prog);
+    fprintf(stderr, "  --compact      one token per string/char literal (default: LEFT/LITERAL/RIGHT quote tokens)\n");
+    fprintf(stderr, "  --symbols      resolve identifiers to declarations and report unresolved/shadowed names\n");
+    fprintf(stderr, "  --brackets     match ( ) { } [ ] while lexing and report unbalanced delimiters\n");
+    fprintf(stderr, "  --only=TYPES   print only these token types, e.g. IDENTIFIER,KEYWORD or OPERATOR\n");
+    fprintf(stderr, "  --count        print per-type token counts instead of tokens\n");
+    fprintf(stderr, "  --index-build=DIR     index identifiers of every .bsc under DIR (incremental)\n");
+    fprintf(stderr, "  --index-lookup=NAME   list file:offset of every use of NAME from the index\n");
+    fprintf(stderr, "  --index-file=PATH     index location (default: bsc.idx)\n");
+    fprintf(stderr, "  --clones=DIR          report token-level clones between .bsc files under DIR\n");
+    fprintf(stderr, "  --clone-window=N      shortest clone in tokens (default: 40)\n");
+    fprintf(stderr, "  --clone-max-copies=N  skip fragments found in more than N files as boilerplate (default: 64)\n");
+    fprintf(stderr, "  --watch=DIR           stay running; re-lex changed .bsc files under DIR into <file>.tok\n");
+    fprintf(stderr, "  --transpile=OUT.c     translate the program to C\n");
+    fprintf(stderr, "  --native=EXE          translate, then compile with $CC (default cc) -O2\n");
+    fprintf(stderr, "  --bench               with --native: time translate, compile and native runs\n");
+    fprintf(stderr, "  --trace=FILE          record phase timings as Chrome trace JSON\n");
+    fprintf(stderr, "  --trace-window=KB     lexing window per trace event (default: 64)\n");
+    fprintf(stderr, "  --max-lexeme=N        copy at most N chars of any lexeme (untrusted input)\n");
+    fprintf(stderr, "  --recover=eof|line    unclosed comment/string runs to end of file (default) or of line\n");
+    fprintf(stderr, "  --stress[=MB]         check linear time and bounded memory on pathological inputs (default: 4)\n");
+}
+
+static double msSince(uint64_t startNs) {
+    return (double)(traceNow() - startNs) / 1e6;
+}
+
+/* Transpile mode: write C to cPath and, when exePath is set, build it with
+   the system compiler; --bench also runs the binary and times each phase. */
+static int runTranspile(const char *source, const char *cPath, const char *exePath, int bench) {
+    uint64_t t0 = traceNow();
+    TRACE_BEGIN("transpile");
+    char *code = NULL;
+    int ok = transpileToC(source, &code);
+    TRACE_END("transpile");
+    if (!ok) return 0;
+    double transpileMs = msSince(t0);
+
+    FILE *f = fopen(cPath, "w");
+    if (!f) { fprintf(stderr, "Error: cannot create '%s'\n", cPath); free(code); return 0; }
+    fputs(code, f);
+    free(code);
+    if (fclose(f) != 0) { fprintf(stderr, "Error: cannot write '%s'\n", cPath); return 0; }
+    if (!exePath) return 1;
+
+    const char *cc = getenv("CC");
+    if (!cc || !cc[0]) cc = "cc";
+    size_t cmdSize = strlen(cc) + 2 * strlen(exePath) + strlen(cPath) + 64;
+    char *cmd = (char *)malloc(cmdSize);
+    /* $CC may carry words of its own ("ccache gcc", "gcc -std=c11"): like
+       make, hand it to the shell unquoted */
+    snprintf(cmd, cmdSize, "%s -O2 -o \"%s\" \"%s\" -lm", cc, exePath, cPath);
+    t0 = traceNow();
+    TRACE_BEGIN("compile");
+    int rc = system(cmd);
+    TRACE_END("compile");
+    double compileMs = msSince(t0);
+    if (rc != 0) { fprintf(stderr, "Error: C compiler failed: %s\n", cmd); free(cmd); return 0; }
+    if (!bench) { free(cmd); return 1; }
+
+#ifdef _WIN32
+    const char *devnull = "NUL";
+#else
+    const char *devnull = "/dev/null";
+#endif
+    int local = (strchr(exePath, '/') == NULL && strchr(exePath, '\\') == NULL);
+    snprintf(cmd, cmdSize, "\"%s%s\" > %s", local ? "./" : "", exePath, devnull);
+    double best = 0;
+    for (int run = 0; run < 3; run++) {
+        t0 = traceNow();
+        TRACE_BEGIN("native run");
+        rc = system(cmd);
+        TRACE_END("native run");
+        double ms = msSince(t0);
+        if (rc != 0) { fprintf(stderr, "Error: '%s' exited with status %d\n", exePath, rc); free(cmd); return 0; }
+        if (run == 0 || ms < best) best = ms;
+    }
+    free(cmd);
+    printf("transpile   %10.3f ms\n", transpileMs);
+    printf("compile     %10.3f ms\n", compileMs);
+    printf("native run  %10.3f ms (best of 3)\n", best);
+    return 1;
+}
+
+/* Query mode: the filter goes into the lexer, so unwanted tokens cost a
+   scan only, and no lexeme is copied - matches print straight from the
+   source span. Nothing is written to symbol_table.txt. */
+static void runQuery(const char *source, TokenMask want, int countOnly, int maxLexeme, LexerRecovery recovery) {
+    Lexer lexer;
+    initLexer(&lexer, source);
+    setTokenFilter(&lexer, want, 0);
+    setLexerLimits(&lexer, maxLexeme, recovery);
+
+    long counts[TOKEN_TYPE_COUNT] = {0};
+    long total = 0;
+    LexTrace lexTrace;
+    lexTraceBegin(&lexTrace);
+    Token tok;
+    for (tok = getNextToken(&lexer); tok.type != TOKEN_EOF; tok = getNextToken(&lexer)) {
+        lexTraceToken(&lexTrace, tok.type, lexer.position);
+        if (countOnly) { counts[tok.type]++; total++; continue; }
+        printf("Lexeme: %-30.*s Token: %s\n", tok.length, source + tok.start, tokenTypeName(tok.type));
+    }
+    lexTraceEnd(&lexTrace);
+
+    if (countOnly) {
+        for (int t = 0; t < TOKEN_TYPE_COUNT; t++) {
+            if (counts[t]) printf("%-24s %ld\n", tokenTypeName((TokenType)t), counts[t]);
+        }
+        printf("%-24s %ld\n", "TOTAL", total);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *input = NULL;
+    int compact = 0;
+    int symbols = 0;
+    int brackets = 0;
+    int query = 0, countOnly = 0;
+    TokenMask want = TOKEN_MASK_ALL;
+    const char *indexDir = NULL, *indexName = NULL, *indexPath = "bsc.idx";
+    const char *tracePath = NULL;
+    const char *cPath = NULL, *exePath = NULL;
+    int bench = 0;
+    const char *watchDir = NULL;
+    const char *cloneDir = NULL;
+    int cloneWindow = 40, cloneMaxBucket = 64;
+    int maxLexeme = 0;
+    LexerRecovery recovery = LEXER_RECOVER_TO_EOF;
+    int stressMb = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--compact") == 0) compact = 1;
+        else if (strcmp(argv[i], "--symbols") == 0) symbols = 1;
+        else if (strcmp(argv[i], "--brackets") == 0) brackets = 1;
+        else if (strcmp(argv[i], "--count") == 0) { query = 1; countOnly = 1; }
+        else if (strncmp(argv[i], "--only=", 7) == 0) {
+            char bad[64];
+            if (!parseTokenMask(argv[i] + 7, &want, bad, sizeof(bad))) {
+                fprintf(stderr, "Error: unknown token type '%s' in --only\n", bad);
+                return 1;
+            }
+            query = 1;
+        }
+        else if (strncmp(argv[i], "--index-build=", 14) == 0) indexDir = argv[i] + 14;
+        else if (strncmp(argv[i], "--index-lookup=", 15) == 0) indexName = argv[i] + 15;
+        else if (strncmp(argv[i], "--index-file=", 13) == 0) indexPath = argv[i] + 13;
+        else if (strncmp(argv[i], "--transpile=", 12) == 0) cPath = argv[i] + 12;
+        else if (strncmp(argv[i], "--native=", 9) == 0) exePath = argv[i] + 9;
+        else if (strcmp(argv[i], "--bench") == 0) bench = 1;
+        else if (strncmp(argv[i], "--watch=", 8) == 0) watchDir = argv[i] + 8;
+        else if (strncmp(argv[i], "--clones=", 9) == 0) cloneDir = argv[i] + 9;
+        else if (strncmp(argv[i], "--clone-window=", 15) == 0) {
+            cloneWindow = atoi(argv[i] + 15);
+            if (cloneWindow <= 0) { usage(argv[0]); return 1; }
+        }
+        else if (strncmp(argv[i], "--clone-max-copies=", 19) == 0) {
+            cloneMaxBucket = atoi(argv[i] + 19);
+            if (cloneMaxBucket < 2) { usage(argv[0]); return 1; }
+        }
+        else if (strncmp(argv[i], "--trace=", 8) == 0) tracePath = argv[i] + 8;
+        else if (strncmp(argv[i], "--trace-window=", 15) == 0) {
+            traceWindowBytes = atoi(argv[i] + 15) * 1024;
+            if (traceWindowBytes <= 0) { usage(argv[0]); return 1; }
+        }
+        else if (strncmp(argv[i], "--max-lexeme=", 13) == 0) {
+            maxLexeme = atoi(argv[i] + 13);
+            if (maxLexeme <= 0) { usage(argv[0]); return 1; }
+        }
+        else if (strcmp(argv[i], "--recover=eof") == 0) recovery = LEXER_RECOVER_TO_EOF;
+        else if (strcmp(argv[i], "--recover=line") == 0) recovery = LEXER_RECOVER_AT_LINE;
+        else if (strcmp(argv[i], "--stress") == 0) stressMb = 4;
+        else if (strncmp(argv[i], "--stress=", 9) == 0) {
+            stressMb = atoi(argv[i] + 9);
+            if (stressMb <= 0) { usage(argv[0]); return 1; }
+        }
+        else if (argv[i][0] == '-' && argv[i][1] == '-') { usage(argv[0]); return 1; }
+        else input = argv[i];
+    }
+
+    if (tracePath) traceEnabled = 1;
+
+    if (stressMb) return runStress(stressMb) ? 0 : 1;
+
+    if (watchDir) {
+#ifdef LEXER_HAVE_INOTIFY
+        return runWatch(watchDir) ? 0 : 1;
+#else
+        fprintf(stderr, "Error: --watch needs inotify (Linux)\n");
+        return 1;
+#endif
+    }
+
+    if (cloneDir) {
+#ifdef LEXER_HAVE_POSIX
+        int ok = findClones(cloneDir, cloneWindow, cloneMaxBucket);
+        if (tracePath && !traceWrite(tracePath)) fprintf(stderr, "Error: cannot write trace '%s'\n", tracePath);
+        return ok ? 0 : 1;
+#else
+        fprintf(stderr, "Error: clone detection is not supported on this platform\n");
+        return 1;
+#endif
+    }
+
+    if (indexDir || indexName) {
+#ifdef LEXER_HAVE_POSIX
+        int built = !indexDir || buildIndex(indexDir, indexPath);
+        if (tracePath && !traceWrite(tracePath)) fprintf(stderr, "Error: cannot write trace '%s'\n", tracePath);
+        if (!built) return 1;
+        if (indexName) {
+            long hits = lookupIndex(indexPath, indexName, stdout);
+            if (hits < 0) { fprintf(stderr, "Error: cannot open index '%s'\n", indexPath); return 1; }
+            if (hits == 0) fprintf(stderr, "'%s' not found\n", indexName);
+        }
+        return 0;
+#else
+        fprintf(stderr, "Error: the identifier index is not supported on this platform\n");
+        return 1;
+#endif
+    }
+
+    if (!input) input = "text.bsc";
+
+    /* Validate extension .bsc (basic check) */
+    size_t L = strlen(input);
+    if (L < 4 || strcasecmp(input + L - 4, ".bsc") != 0) {
+        fprintf(stderr, "Error: expected a .bsc file (got '%s')\n", input);
+        return 1;
+    }
+
+    char *source = readFile(input);
+    if (!source) {
+        fprintf(stderr, "Error: cannot open file '%s'\n", input);
+        return 1;
+    }
+
+    if (cPath || exePath) {
+        char generated[4096];
+        if (!cPath) { snprintf(generated, sizeof(generated), "%s.c", exePath); cPath = generated; }
+        int ok = runTranspile(source, cPath, exePath, bench);
+        free(source);
+        if (tracePath && !traceWrite(tracePath)) fprintf(stderr, "Error: cannot write trace '%s'\n", tracePath);
+        return ok ? 0 : 1;
+    }
+
+    if (query) {
+        runQuery(source, want, countOnly, maxLexeme, recovery);
+        free(source);
+        if (tracePath && !traceWrite(tracePath)) fprintf(stderr, "Error: cannot write trace '%s'\n", tracePath);
+        return 0;
+    }
+
+    Lexer lexer;
+    initLexer(&lexer, source);
+    setLexerLimits(&lexer, maxLexeme, recovery);
+
+    FILE *out = fopen("symbol_table.txt", "w");
+    if (!out) { fprintf(stderr, "Error: cannot create symbol_table.txt\n"); free(source); return 1; }
+
+    LiteralCache literals;
+    initLiteralCache(&literals);
+    SymbolTable table;
+    if (symbols) initSymbolTable(&table, source, NULL);
+    BracketIndex bracketIndex;
+    if (brackets) {
+        initBracketIndex(&bracketIndex, NULL);
+        trackBrackets(&lexer, &bracketIndex);
+    }
+
+    static DumpSink sink;
+    sink.used = 0;
+    sink.console = stdout;
+    sink.file = out;
+
+    LexTrace lexTrace;
+    lexTraceBegin(&lexTrace);
+
+    Token tok;
+    int index = 0;
+    do {
+        tok = compact ? getNextToken(&lexer) : getNextLegacyToken(&lexer);
+        lexTraceToken(&lexTrace, tok.type, lexer.position);
+        if (symbols) symbolsFeed(&table, &tok, index++);
+        const char *tname = tokenTypeName(tok.type);
+        const char *lex = tok.lexeme ? tok.lexeme : "";
+        int lexLen = (int)strlen(lex);
+        const char *note = "";
+        if (compact && (tok.type == TOKEN_STRING_LITERAL || tok.type == TOKEN_CHAR_LITERAL)) {
+            lex = literalRaw(source, &tok, &lexLen);
+            const char *value; int valueLen;
+            if (!decodeLiteral(&literals, source, &tok, &value, &valueLen)) note = " (invalid escape)";
+        }
+        if (tok.flags & TOKEN_FLAG_UNTERMINATED) note = " (unterminated)";
+        else if (tok.flags & TOKEN_FLAG_TRUNCATED) note = " (truncated)";
+        sinkLine(&sink, "Lexeme: %-30.*s Token: %s%s\n", lexLen, lex, tname, note);
+        freeToken(&lexer, &tok);
+    } while (tok.type != TOKEN_EOF);
+
+    lexTraceEnd(&lexTrace);
+    sinkFlush(&sink);
+
+    if (symbols) {
+        symbolsFinish(&table);
+        printSymbolReport(&table, stdout);
+        freeSymbolTable(&table);
+    }
+    if (brackets) {
+        printBracketReport(&bracketIndex, source, stdout);
+        freeBracketIndex(&bracketIndex);
+    }
+
+    freeLiteralCache(&literals);
+    fclose(out);
+    free(source);
+    if (tracePath && !traceWrite(tracePath)) fprintf(stderr, "Error: cannot write trace '%s'\n", tracePath);
+    return 0;
+}
+